@@ -1,8 +1,17 @@
 #include "AbstractStatCollector.h"
+#include "VariantAlleles.h"
+
+#include <cmath>
+#include <typeinfo>
 
 using namespace VcfStatsAlive;
 
-AbstractStatCollector::AbstractStatCollector(const std::string* sampleName) {
+// Sample size below which the normal approximation is not trusted
+static const double kMinProportionSamples = 100;
+
+AbstractStatCollector::AbstractStatCollector(const std::string* sampleName) :
+	_samplingHalfWidth(0),
+	_samplingZ(0) {
 	_children.clear();
 }
 
@@ -35,13 +44,22 @@ void AbstractStatCollector::removeChild(StatCollectorPtr child) {
 	_children.erase(loc);
 }
 
+// Nesting level of processVariant() calls on this thread
+static thread_local int processDepth = 0;
+
 void AbstractStatCollector::processVariant(bcf_hdr_t* hdr, bcf1_t* var) {
 
+	// A record entering the root of a tree is new, even if its buffer is not
+	if(processDepth == 0) VariantAlleles::invalidate();
+	processDepth++;
+
 	this->processVariantImpl(hdr, var);
 
 	for(auto iter = _children.begin(); iter != _children.end(); iter++) {
 		(*iter)->processVariant(hdr, var);
 	}
+
+	processDepth--;
 }
 
 json_t * AbstractStatCollector::appendJson(json_t * jsonRootObj) {
@@ -57,6 +75,17 @@ json_t * AbstractStatCollector::appendJson(json_t * jsonRootObj) {
 	return jsonRootObj;
 }
 
+void AbstractStatCollector::merge(const AbstractStatCollector& other) {
+	assert(typeid(*this) == typeid(other));
+	assert(_children.size() == other._children.size());
+
+	this->mergeImpl(other);
+
+	for(size_t i = 0; i < _children.size() && i < other._children.size(); i++) {
+		_children[i]->merge(*other._children[i]);
+	}
+}
+
 bool AbstractStatCollector::isSatisfiedImpl() {
 	return false;
 }
@@ -72,3 +101,62 @@ bool AbstractStatCollector::isSatisfied() {
 
 	return isChildrenSatisfied;
 }
+
+void AbstractStatCollector::setSamplingTargetImpl(double halfWidth, double z) {
+	_samplingHalfWidth = halfWidth;
+	_samplingZ = z;
+}
+
+void AbstractStatCollector::setSamplingTarget(double halfWidth, double z) {
+	this->setSamplingTargetImpl(halfWidth, z);
+
+	for(auto iter = _children.begin(); iter != _children.end(); iter++) {
+		(*iter)->setSamplingTarget(halfWidth, z);
+	}
+}
+
+double AbstractStatCollector::requiredSampleSize() const {
+	return (_samplingZ * _samplingZ) / (4 * _samplingHalfWidth * _samplingHalfWidth);
+}
+
+bool AbstractStatCollector::isProportionSettled(double hits, double n, double records) const {
+	if(_samplingHalfWidth <= 0) return false;
+	if(n == 0) return records >= requiredSampleSize();
+	if(n < kMinProportionSamples) return false;
+
+	double p = hits / n;
+	return _samplingZ * sqrt(p * (1 - p) / n) <= _samplingHalfWidth;
+}
+
+std::vector<size_t> AbstractStatCollector::matchSamples(std::vector<std::string>& sampleNames,
+		const std::vector<std::string>& otherNames) {
+	std::map<std::string, size_t> sampleByName;
+	for(size_t s = 0; s < sampleNames.size(); s++) sampleByName[sampleNames[s]] = s;
+
+	std::vector<size_t> sampleOfOther(otherNames.size());
+	for(size_t otherSample = 0; otherSample < otherNames.size(); otherSample++) {
+		std::map<std::string, size_t>::iterator loc = sampleByName.find(otherNames[otherSample]);
+		if(loc != sampleByName.end()) {
+			sampleOfOther[otherSample] = loc->second;
+			continue;
+		}
+
+		sampleOfOther[otherSample] = sampleNames.size();
+		sampleNames.push_back(otherNames[otherSample]);
+	}
+
+	return sampleOfOther;
+}
+
+double AbstractStatCollector::zScore(double confidence) {
+
+	// Invert the two-sided coverage erf(z / sqrt(2)) by bisection
+	double lower = 0, upper = 10;
+	for(int i = 0; i < 64; i++) {
+		double mid = (lower + upper) / 2;
+		if(erf(mid / sqrt(2.0)) < confidence) lower = mid;
+		else upper = mid;
+	}
+
+	return (lower + upper) / 2;
+}
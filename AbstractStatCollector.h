@@ -13,6 +13,10 @@ namespace VcfStatsAlive {
 
 	using StatCollectorPtrVec = std::vector<StatCollectorPtr>;
 
+	// Records between two isSatisfied() checks of a sampled tree, which
+	// walk the whole tree
+	static const size_t kSatisfiedCheckInterval = 1000;
+
 	/**
 	 * The base class for all statistics collectors
 	 *
@@ -25,12 +29,17 @@ namespace VcfStatsAlive {
 	 * the public processVariant() and appendJson() functions on the root
 	 * object, and the action will be propagated across all child nodes. The
 	 * actual implementation of specific collectors is encapsulated by the
-	 * protected processVariantImpl() and appendJsonImpl() functions
+	 * protected processVariantImpl(), appendJsonImpl() and mergeImpl() functions
 	 */
 	class AbstractStatCollector {
 		protected:
 			StatCollectorPtrVec _children;
 
+			// Sampling target, see setSamplingTarget(); a half-width of 0
+			// means that the collector is never satisfied
+			double _samplingHalfWidth;
+			double _samplingZ;
+
 			/**
 			 * Process the variant and update statistics
 			 *
@@ -46,6 +55,13 @@ namespace VcfStatsAlive {
 			 */
 			virtual void appendJsonImpl(json_t * jsonRootObj) = 0;
 
+			/**
+			 * Merge the statistics of another collector into this one
+			 *
+			 * @param other A collector of the same concrete type as this one
+			 */
+			virtual void mergeImpl(const AbstractStatCollector& other) = 0;
+
 			/** 
 			 * Check if the statistics collector is satisfied with the data it
 			 * has seen so far. Note that the defualt implementation of this
@@ -56,6 +72,48 @@ namespace VcfStatsAlive {
 			 */
 			virtual bool isSatisfiedImpl();
 
+			/**
+			 * Store the sampling target of the collector. Collectors that
+			 * hold collectors of their own (e.g. stratifiers) pass it on.
+			 *
+			 * @param halfWidth The confidence interval half-width to reach
+			 * @param z The standard score of the confidence level
+			 */
+			virtual void setSamplingTargetImpl(double halfWidth, double z);
+
+			/**
+			 * @return The number of observations after which any proportion
+			 *         is known to the sampling target, i.e. z^2 / (4 h^2)
+			 */
+			double requiredSampleSize() const;
+
+			/**
+			 * Check if a proportion estimated from a sample is known to the
+			 * sampling target, using the normal approximation of its
+			 * confidence interval. A proportion with no observations at all
+			 * is considered settled once the collector has seen enough
+			 * records that its share of them is known to be negligible.
+			 *
+			 * @param hits The number of observations in the category
+			 * @param n The number of observations of the proportion
+			 * @param records The number of records seen by the collector
+			 * @return true if the proportion is precise enough
+			 */
+			bool isProportionSettled(double hits, double n, double records) const;
+
+			/**
+			 * Match the samples of a collector being merged to those of this
+			 * one by name, for collectors with per-sample tables. Inputs may
+			 * list different samples, so samples this collector lacks are
+			 * appended, and the caller grows its tables to the new count.
+			 *
+			 * @param sampleNames The samples of this collector, extended
+			 * @param otherNames The samples of the other collector
+			 * @return The index in sampleNames of each of otherNames
+			 */
+			static std::vector<size_t> matchSamples(std::vector<std::string>& sampleNames,
+					const std::vector<std::string>& otherNames);
+
 		public:
 			AbstractStatCollector(const std::string* sampleName = NULL);
 			virtual ~AbstractStatCollector();
@@ -100,12 +158,41 @@ namespace VcfStatsAlive {
 			 */
 			json_t * appendJson(json_t * jsonRootObj = NULL);
 
+			/**
+			 * Merge another collector tree into this one
+			 *
+			 * Both trees must have been built the same way, e.g. one tree per
+			 * input shard from the same construction code. The statistics of
+			 * each node in the other tree are folded into the corresponding
+			 * node of this tree, so that the result equals a single tree that
+			 * processed all the variants of both.
+			 *
+			 * @param other The collector tree to be merged; it is left unchanged
+			 */
+			void merge(const AbstractStatCollector& other);
+
 			/**
 			 * Check satisfy-ness of the collector tree
 			 *
 			 * @return true if all collectors in the tree are satisfied, false otherwise
 			 */
 			bool isSatisfied();
+
+			/**
+			 * Set the precision at which the collector tree considers itself
+			 * satisfied, for sampling a part of the input
+			 *
+			 * @param halfWidth The confidence interval half-width to reach
+			 *                  for the proportions estimated by the collectors
+			 * @param z The standard score of the confidence level, see zScore()
+			 */
+			void setSamplingTarget(double halfWidth, double z);
+
+			/**
+			 * @param confidence A two-sided confidence level, e.g. 0.95
+			 * @return The matching standard score, e.g. 1.96
+			 */
+			static double zScore(double confidence);
 	};
 
 }
@@ -0,0 +1,132 @@
+#include "AlleleFrequencyCollector.h"
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+AlleleFrequencyCollector::AlleleFrequencyCollector(int bins) :
+	AbstractStatCollector(),
+	m_hist(EdgeBinning<double>::uniform(0.0, 1.0, bins)) {
+
+	init();
+}
+
+AlleleFrequencyCollector::AlleleFrequencyCollector(const vector<double>& edges) :
+	AbstractStatCollector(),
+	m_hist(EdgeBinning<double>(edges)) {
+
+	init();
+}
+
+void AlleleFrequencyCollector::init() {
+	m_records = 0;
+	m_noFrequency = 0;
+
+	m_af = NULL;
+	m_afSize = 0;
+	m_counts = NULL;
+	m_countsSize = 0;
+}
+
+AlleleFrequencyCollector::~AlleleFrequencyCollector() {
+	free(m_af);
+	free(m_counts);
+}
+
+bool AlleleFrequencyCollector::parseBins(const string& spec, vector<double>& edges) {
+	edges.clear();
+
+	if(spec.find(',') == string::npos) {
+		char* end;
+		long bins = strtol(spec.c_str(), &end, 10);
+		if(*end != 0 || bins <= 0) return false;
+
+		for(long i = 0; i <= bins; i++) edges.push_back(double(i) / bins);
+		return true;
+	}
+
+	stringstream ss(spec);
+	string edge;
+	while(getline(ss, edge, ',')) {
+		char* end;
+		double value = strtod(edge.c_str(), &end);
+		if(edge.empty() || *end != 0) return false;
+		if(!edges.empty() && value <= edges.back()) return false;
+		edges.push_back(value);
+	}
+
+	return edges.size() >= 2;
+}
+
+void AlleleFrequencyCollector::processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) {
+	m_records++;
+
+	int altCount = var->n_allele - 1;
+	if(altCount <= 0) return;
+
+	if(bcf_get_info_float(hdr, var, "AF", &m_af, &m_afSize) == altCount) {
+		for(int i = 0; i < altCount; i++) {
+			if(bcf_float_is_missing(m_af[i])) {
+				m_noFrequency++;
+				continue;
+			}
+			m_hist.add(m_af[i]);
+		}
+		return;
+	}
+
+	int32_t an = 0;
+	if(bcf_get_info_int32(hdr, var, "AN", &m_counts, &m_countsSize) == 1) an = m_counts[0];
+	if(an <= 0 || bcf_get_info_int32(hdr, var, "AC", &m_counts, &m_countsSize) != altCount) {
+		m_noFrequency += altCount;
+		return;
+	}
+
+	for(int i = 0; i < altCount; i++) {
+		if(m_counts[i] == bcf_int32_missing) {
+			m_noFrequency++;
+			continue;
+		}
+		m_hist.add(double(m_counts[i]) / an);
+	}
+}
+
+void AlleleFrequencyCollector::mergeImpl(const AbstractStatCollector& otherCollector) {
+	const AlleleFrequencyCollector& other = static_cast<const AlleleFrequencyCollector&>(otherCollector);
+
+	m_records += other.m_records;
+	m_noFrequency += other.m_noFrequency;
+	m_hist.merge(other.m_hist);
+}
+
+bool AlleleFrequencyCollector::isSatisfiedImpl() {
+	double alleles = m_hist.total();
+	for(size_t i = 0; i < m_hist.slots(); i++) {
+		if(!isProportionSettled(m_hist.slotCount(i), alleles, m_records)) return false;
+	}
+
+	return true;
+}
+
+void AlleleFrequencyCollector::appendJsonImpl(json_t * jsonRootObj) {
+	json_t * j_af = json_object();
+
+	const vector<double>& edges = m_hist.binning().edges();
+	json_t * j_edges = json_array();
+	for(size_t i = 0; i < edges.size(); i++) json_array_append_new(j_edges, json_real(edges[i]));
+	json_object_set_new(j_af, "edges", j_edges);
+
+	// Frequencies outside the edges count in the first or last bin
+	size_t bins = m_hist.bins();
+	json_t * j_bins = json_array();
+	for(size_t i = 0; i < bins; i++) {
+		uint64_t count = m_hist.count(i);
+		if(i == 0) count += m_hist.underflow();
+		if(i == bins - 1) count += m_hist.overflow();
+		json_array_append_new(j_bins, json_integer(count));
+	}
+	json_object_set_new(j_af, "bins", j_bins);
+
+	json_object_set_new(j_af, "noFrequency", json_integer(m_noFrequency));
+
+	json_object_set_new(jsonRootObj, "alt_af_hist", j_af);
+}
@@ -0,0 +1,67 @@
+#ifndef ALLELEFREQUENCYCOLLECTOR_H
+#define ALLELEFREQUENCYCOLLECTOR_H
+
+#pragma once
+
+#include "AbstractStatCollector.h"
+#include "Histogram.h"
+
+namespace VcfStatsAlive {
+
+	/**
+	 * Collect the allele frequency histogram of every alternate allele
+	 *
+	 * Unlike the af_hist of BasicStatsCollector, which bins the first AF
+	 * value of a record, each ALT of a multiallelic record is binned by its
+	 * own frequency: INFO/AF where present, else INFO/AC / INFO/AN. Bins
+	 * are either uniform over [0, 1] or given by ascending edges, e.g. a
+	 * rare-variant scale of 0, 0.001, 0.01, 0.05, 0.5, 1. Frequencies
+	 * below the first or above the last edge land in the first or last bin.
+	 */
+	class AlleleFrequencyCollector : public AbstractStatCollector {
+
+		protected:
+			uint64_t m_records;
+			uint64_t m_noFrequency;		// alleles without AF or AC/AN
+			Histogram<EdgeBinning<double> > m_hist;
+
+			// reusable INFO buffers
+			float* m_af;
+			int m_afSize;
+			int32_t* m_counts;
+			int m_countsSize;
+
+			virtual void processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) override;
+			virtual void appendJsonImpl(json_t * jsonRootObj) override;
+			virtual void mergeImpl(const AbstractStatCollector& other) override;
+			virtual bool isSatisfiedImpl() override;
+
+		private:
+			void init();
+
+		public:
+			/**
+			 * @param bins The number of equal-width bins over [0, 1]
+			 */
+			AlleleFrequencyCollector(int bins);
+
+			/**
+			 * @param edges Ascending bin edges, at least two
+			 */
+			AlleleFrequencyCollector(const std::vector<double>& edges);
+
+			virtual ~AlleleFrequencyCollector();
+
+			/**
+			 * Parse a bin specification, either a bin count such as "20" or
+			 * comma separated edges such as "0,0.01,0.05,1"
+			 *
+			 * @param spec The specification
+			 * @param edges Receives the edges; a bin count gives uniform edges
+			 * @return false if the specification is invalid
+			 */
+			static bool parseBins(const std::string& spec, std::vector<double>& edges);
+	};
+}
+
+#endif
@@ -0,0 +1,201 @@
+#include "AlleleSpectrumCollector.h"
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+AlleleSpectrumCollector::AlleleSpectrumCollector(bcf_hdr_t* hdr, bool trustInfoCounts) :
+	AbstractStatCollector(),
+	m_trustInfoCounts(trustInfoCounts),
+	m_sites(0),
+	m_alleles(0),
+	m_noCounts(0),
+	m_spectrumOverflow(0),
+	m_alleleNumberOverflow(0),
+	m_gt(NULL),
+	m_gtSize(0),
+	m_info(NULL),
+	m_infoSize(0) {
+
+	size_t samples = bcf_hdr_nsamples(hdr);
+	m_sampleNames.resize(samples);
+	for(size_t i = 0; i < samples; i++) m_sampleNames[i] = hdr->samples[i];
+
+	m_singletons.assign(samples, 0);
+	m_doubletons.assign(samples, 0);
+
+	m_spectrum.assign(2 * samples + 1, 0);
+	m_alleleNumbers.assign(2 * samples + 1, 0);
+	m_infoLimit = samples > 0 ? 2 * samples : kMaxInfoAlleleNumber;
+}
+
+AlleleSpectrumCollector::~AlleleSpectrumCollector() {
+	free(m_gt);
+	free(m_info);
+}
+
+bool AlleleSpectrumCollector::countFromInfo(bcf_hdr_t* hdr, bcf1_t* var, int32_t& an) {
+	int alleleCount = var->n_allele;
+
+	if(bcf_get_info_int32(hdr, var, "AN", &m_info, &m_infoSize) != 1) return false;
+	an = m_info[0];
+
+	if(bcf_get_info_int32(hdr, var, "AC", &m_info, &m_infoSize) != alleleCount - 1) return false;
+	for(int i = 1; i < alleleCount; i++) {
+		if(m_info[i - 1] == bcf_int32_missing || m_info[i - 1] < 0) return false;
+		m_alleleCounts[i] = m_info[i - 1];
+	}
+
+	return an != bcf_int32_missing && an >= 0;
+}
+
+void AlleleSpectrumCollector::countFromGenotypes(int ngt, int alleleCount, int32_t& an) {
+	const int32_t* gt = m_gt;
+
+	if(alleleCount == 2) {
+		// A called allele has a non-zero index field, allele 1 encodes as 2
+		int32_t ac = 0, called = 0;
+		for(int i = 0; i < ngt; i++) {
+			int32_t code = gt[i] >> 1;
+			int32_t present = (gt[i] != bcf_int32_vector_end) & (code != 0);
+			called += present;
+			ac += present & (code == 2);
+		}
+		m_alleleCounts[1] = ac;
+		an = called;
+		return;
+	}
+
+	an = 0;
+	for(int i = 0; i < ngt; i++) {
+		if(gt[i] == bcf_int32_vector_end || bcf_gt_is_missing(gt[i])) continue;
+		int allele = bcf_gt_allele(gt[i]);
+		if(allele < alleleCount) m_alleleCounts[allele]++;
+		an++;
+	}
+}
+
+void AlleleSpectrumCollector::creditCarriers(size_t samples, int ploidy, int alleleCount) {
+	for(size_t s = 0; s < samples; s++) {
+		const int32_t* gt = m_gt + s * ploidy;
+		int previous = -1;
+		for(int i = 0; i < ploidy && gt[i] != bcf_int32_vector_end; i++) {
+			if(bcf_gt_is_missing(gt[i])) continue;
+			int allele = bcf_gt_allele(gt[i]);
+			if(allele <= 0 || allele >= alleleCount || allele == previous) continue;
+			previous = allele;
+
+			m_singletons[s] += (m_alleleCounts[allele] == 1);
+			m_doubletons[s] += (m_alleleCounts[allele] == 2);
+		}
+	}
+}
+
+void AlleleSpectrumCollector::count(vector<uint64_t>& counts, uint64_t& overflow, size_t value, bool fromInfo) {
+	if(value >= counts.size()) {
+		if(fromInfo && value > m_infoLimit) {
+			overflow++;
+			return;
+		}
+		counts.resize(value + 1, 0);
+	}
+	counts[value]++;
+}
+
+void AlleleSpectrumCollector::processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) {
+	int alleleCount = var->n_allele;
+	if(alleleCount < 2) return;
+
+	m_sites++;
+	m_alleles += alleleCount - 1;
+	m_alleleCounts.assign(alleleCount, 0);
+
+	int ngt = 0;
+	if(bcf_hdr_nsamples(hdr) > 0) ngt = bcf_get_genotypes(hdr, var, &m_gt, &m_gtSize);
+
+	int32_t an = 0;
+	bool fromInfo = m_trustInfoCounts && countFromInfo(hdr, var, an);
+	bool counted = fromInfo;
+	if(!counted && ngt > 0) {
+		m_alleleCounts.assign(alleleCount, 0);
+		countFromGenotypes(ngt, alleleCount, an);
+		counted = true;
+	}
+	if(!counted) {
+		m_noCounts += alleleCount - 1;
+		return;
+	}
+
+	count(m_alleleNumbers, m_alleleNumberOverflow, an, fromInfo);
+
+	bool anyRare = false;
+	for(int i = 1; i < alleleCount; i++) {
+		size_t ac = m_alleleCounts[i];
+		count(m_spectrum, m_spectrumOverflow, ac, fromInfo);
+		anyRare = anyRare || ac == 1 || ac == 2;
+	}
+
+	// Most records have no singleton or doubleton to credit
+	if(anyRare && ngt > 0) {
+		size_t samples = min(m_sampleNames.size(), size_t(bcf_hdr_nsamples(hdr)));
+		creditCarriers(samples, ngt / bcf_hdr_nsamples(hdr), alleleCount);
+	}
+}
+
+static void addDense(vector<uint64_t>& into, const vector<uint64_t>& from) {
+	if(into.size() < from.size()) into.resize(from.size(), 0);
+	for(size_t i = 0; i < from.size(); i++) into[i] += from[i];
+}
+
+void AlleleSpectrumCollector::mergeImpl(const AbstractStatCollector& otherCollector) {
+	const AlleleSpectrumCollector& other = static_cast<const AlleleSpectrumCollector&>(otherCollector);
+
+	m_sites += other.m_sites;
+	m_alleles += other.m_alleles;
+	m_noCounts += other.m_noCounts;
+	addDense(m_spectrum, other.m_spectrum);
+	addDense(m_alleleNumbers, other.m_alleleNumbers);
+	m_spectrumOverflow += other.m_spectrumOverflow;
+	m_alleleNumberOverflow += other.m_alleleNumberOverflow;
+
+	vector<size_t> sampleOfOther = matchSamples(m_sampleNames, other.m_sampleNames);
+	m_singletons.resize(m_sampleNames.size(), 0);
+	m_doubletons.resize(m_sampleNames.size(), 0);
+
+	for(size_t otherSample = 0; otherSample < other.m_sampleNames.size(); otherSample++) {
+		m_singletons[sampleOfOther[otherSample]] += other.m_singletons[otherSample];
+		m_doubletons[sampleOfOther[otherSample]] += other.m_doubletons[otherSample];
+	}
+}
+
+static json_t* denseToJson(const vector<uint64_t>& counts) {
+	// Trailing empty bins of the header-sized array are left out
+	size_t used = counts.size();
+	while(used > 0 && counts[used - 1] == 0) used--;
+
+	json_t * j_counts = json_array();
+	for(size_t i = 0; i < used; i++) json_array_append_new(j_counts, json_integer(counts[i]));
+	return j_counts;
+}
+
+void AlleleSpectrumCollector::appendJsonImpl(json_t * jsonRootObj) {
+	json_t * j_sfs = json_object();
+
+	json_object_set_new(j_sfs, "sites", json_integer(m_sites));
+	json_object_set_new(j_sfs, "alleles", json_integer(m_alleles));
+	json_object_set_new(j_sfs, "noCounts", json_integer(m_noCounts));
+	json_object_set_new(j_sfs, "spectrum", denseToJson(m_spectrum));
+	json_object_set_new(j_sfs, "alleleNumbers", denseToJson(m_alleleNumbers));
+	json_object_set_new(j_sfs, "spectrumOverflow", json_integer(m_spectrumOverflow));
+	json_object_set_new(j_sfs, "alleleNumberOverflow", json_integer(m_alleleNumberOverflow));
+
+	json_t * j_samples = json_object();
+	for(size_t s = 0; s < m_sampleNames.size(); s++) {
+		json_t * j_sample = json_object();
+		json_object_set_new(j_sample, "singletons", json_integer(m_singletons[s]));
+		json_object_set_new(j_sample, "doubletons", json_integer(m_doubletons[s]));
+		json_object_set_new(j_samples, m_sampleNames[s].c_str(), j_sample);
+	}
+	json_object_set_new(j_sfs, "samples", j_samples);
+
+	json_object_set_new(jsonRootObj, "sfs", j_sfs);
+}
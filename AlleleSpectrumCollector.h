@@ -0,0 +1,78 @@
+#ifndef ALLELESPECTRUMCOLLECTOR_H
+#define ALLELESPECTRUMCOLLECTOR_H
+
+#pragma once
+
+#include "AbstractStatCollector.h"
+
+namespace VcfStatsAlive {
+
+	/**
+	 * Collect the site frequency spectrum of a cohort, and per-sample
+	 * singleton and doubleton counts
+	 *
+	 * Every alternate allele adds one count to the spectrum bin of its
+	 * allele count (AC), and every site one count to the distribution of
+	 * its allele number (AN). AC and AN are counted from GT, or taken from
+	 * INFO/AC and INFO/AN when these are present and trusted. Both arrays
+	 * are dense, sized for the diploid allele number of the header's
+	 * samples, and grow for the higher ploidies found in GT. INFO values
+	 * are not checked against the genotypes, so they only grow the arrays
+	 * of sites-only files, up to kMaxInfoAlleleNumber; larger values are
+	 * counted in overflow bins. Biallelic records, the vast majority, are
+	 * counted by a branch-free reduction over the GT array.
+	 *
+	 * A singleton (doubleton) is an alternate allele with AC 1 (2); it
+	 * counts once for each sample carrying it, so a homozygous doubleton
+	 * counts once for its one carrier.
+	 */
+	class AlleleSpectrumCollector : public AbstractStatCollector {
+
+		protected:
+			bool m_trustInfoCounts;
+
+			uint64_t m_sites;
+			uint64_t m_alleles;
+			uint64_t m_noCounts;	// alleles without GT or INFO/AC
+			std::vector<uint64_t> m_spectrum;		// alleles by AC
+			std::vector<uint64_t> m_alleleNumbers;	// sites by AN
+			uint64_t m_spectrumOverflow;		// alleles with an INFO/AC past m_infoLimit
+			uint64_t m_alleleNumberOverflow;	// sites with an INFO/AN past m_infoLimit
+			size_t m_infoLimit;
+
+			std::vector<std::string> m_sampleNames;
+			std::vector<uint32_t> m_singletons;
+			std::vector<uint32_t> m_doubletons;
+
+			// reusable per-record buffers
+			int32_t* m_gt;
+			int m_gtSize;
+			int32_t* m_info;
+			int m_infoSize;
+			std::vector<int32_t> m_alleleCounts;
+
+			virtual void processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) override;
+			virtual void appendJsonImpl(json_t * jsonRootObj) override;
+			virtual void mergeImpl(const AbstractStatCollector& other) override;
+
+		private:
+			bool countFromInfo(bcf_hdr_t* hdr, bcf1_t* var, int32_t& an);
+			void countFromGenotypes(int ngt, int alleleCount, int32_t& an);
+			void creditCarriers(size_t samples, int ploidy, int alleleCount);
+			void count(std::vector<uint64_t>& counts, uint64_t& overflow, size_t value, bool fromInfo);
+
+		public:
+			// Largest INFO/AC or INFO/AN counted for a file without samples
+			static const size_t kMaxInfoAlleleNumber = 1 << 22;
+
+			/**
+			 * @param hdr The vcf header providing the samples
+			 * @param trustInfoCounts Use INFO/AC and INFO/AN where present
+			 *                        instead of counting GT
+			 */
+			AlleleSpectrumCollector(bcf_hdr_t* hdr, bool trustInfoCounts = true);
+			virtual ~AlleleSpectrumCollector();
+	};
+}
+
+#endif
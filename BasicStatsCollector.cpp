@@ -1,4 +1,5 @@
 #include "BasicStatsCollector.h"
+#include "NucleotideTables.h"
 
 #include <cmath>
 
@@ -19,16 +20,6 @@ namespace VcfStatsAlive {
 		return ss >> result ? result : 0;
 	}
 
-	template <typename T>
-	inline int valueToBinCloseInterval(T value, T minValue, T maxValue, int bins) {
-		return  floor((value - minValue) / (maxValue - minValue) * bins);
-	}
-
-	template <typename T>
-	inline int valueToBinOpenInterval(T value, T minValue, T maxValue, int bins) {
-		if (value < minValue) return 0;
-		else return valueToBinCloseInterval(value, minValue, maxValue, bins-1) + 1;
-	}
 }
 
 using namespace VcfStatsAlive;
@@ -37,26 +28,10 @@ static const unsigned int kCMTrailLength = 5;
 static const double kCMThreshold = 0.001;
 static const double kLogAFLowerBound = -5.0;
 static const double kLogAFUpperBound = 0.0;
-
-inline bool _isPurine(const char allele) {
-	//if(allele.length() != 1) return false;
-	if(allele == 'A' || allele == 'a' || allele == 'G' || allele == 'g') return true;
-	return false;
-}
-
-inline bool _isPyrimidine(const char allele) {
-	//if(allele.length() != 1) return false;
-	if(allele == 'C' || allele == 'c' || allele == 'T' || allele == 't') return true;
-	return false;
-}
-
-inline size_t base2Idx(const char base) {
-	if(base == 'A' || base == 'a') return 0;
-	else if (base == 'G' || base == 'g') return 1;
-	else if (base == 'C' || base == 'c') return 2;
-	else if (base == 'T' || base == 't') return 3;
-	else return 4;
-}
+static const size_t kAFHistBins = 50;
+static const size_t kBaseIdxCount = 5;
+static const double kIndelSizePrecision = 1.0 / 32;
+static const int64_t kMaxIndelSize = INT32_MAX;
 
 inline char idx2Base(size_t idx) {
 	switch(idx) {
@@ -80,21 +55,21 @@ BasicStatsCollector::BasicStatsCollector(int qualLower, int qualUpper, bool logS
 	usingLogScaleAF(logScaleAF),
 	kQualHistLowerbound(qualLower),
 	kQualHistUpperbound(qualUpper),
-	m_qualityDist(qualUpper - qualLower + 1 + 2, 0) {
+	m_alleleFreqHist(logScaleAF ?
+			LinearBinning<double>(kLogAFLowerBound, kLogAFUpperBound, kAFHistBins) :
+			LinearBinning<double>(0.0, 1.0, kAFHistBins)),
+	// Values up to qualUpper + 1 get a bin of their own, see appendJsonImpl()
+	m_qualityDist(LinearBinning<int>(qualLower, qualUpper + 2, qualUpper - qualLower + 2)),
+	m_mutationSpec(IndexBinning(kBaseIdxCount * kBaseIdxCount)),
+	m_variantTypeDist(IndexBinning(VT_SIZE)),
+	m_insertionSizeDist(HdrBinning(kIndelSizePrecision, kMaxIndelSize)),
+	m_deletionSizeDist(HdrBinning(kIndelSizePrecision, kMaxIndelSize)) {
 
 	_stats.clear();
 
 	_stats[kTotalRecords] = 0;
 	_stats[kTsTvRatio] = 0;
 
-	_alleleFreqBins = logScaleAF ? 52 : 51;
-	m_alleleFreqHist = (unsigned int *)malloc(sizeof(unsigned int) * _alleleFreqBins);
-
-
-	memset(m_alleleFreqHist, 0, sizeof(unsigned int) * _alleleFreqBins);
-	memset(m_mutationSpec, 0, sizeof(unsigned int) * 4 * 4);
-	memset(m_variantTypeDist, 0, sizeof(unsigned int) * static_cast<unsigned int>(VT_SIZE));
-
 
 #ifdef DEBUG
 	StatMapT::iterator iter;
@@ -106,36 +81,20 @@ BasicStatsCollector::BasicStatsCollector(int qualLower, int qualUpper, bool logS
 }
 
 BasicStatsCollector::~BasicStatsCollector() {
-	free(m_alleleFreqHist);
 }
 
 void BasicStatsCollector::updateTsTvRatio(bcf1_t* var, int altIndex, bool isSnp) {
 	// TsTv Ratio - Only evaluate SNPs 
 
-	char ref = var->d.allele[0][0];
-	char htsAlt = var->d.allele[altIndex][0];
 #ifdef VCFLIB_PARITY
 	if(var->d.allele[0][1] == 0 && var->d.allele[altIndex][1] == 0 && var->d.allele[0][0] != '.' && var->d.allele[altIndex][0] != '.')
 #else
 	if(isSnp) 
 #endif
     {
-		if(_isPurine(ref)) {
-			if(_isPurine(htsAlt)) {
-				_transitions++;
-			}
-			else if(_isPyrimidine(htsAlt)){
-				_transversions++;
-			} 
-		}
-		else {
-			if(_isPurine(htsAlt)) {
-				_transversions++;
-			}
-			else if(_isPyrimidine(htsAlt)){
-				_transitions++;
-			} 
-		}	
+		uint8_t substitution = substitutionClass(var->d.allele[0][0], var->d.allele[altIndex][0]);
+		_transitions += (substitution == SC_TRANSITION);
+		_transversions += (substitution == SC_TRANSVERSION);
 	}
 
 }
@@ -148,17 +107,12 @@ void BasicStatsCollector::updateMutationSpectrum(bcf1_t* var, int altIndex, bool
 	if(!isSnp) return;
 #endif
 
-	size_t firstIdx = base2Idx(var->d.allele[0][0]);
-	size_t secondIdx = base2Idx(var->d.allele[altIndex][0]);
-
-	if(firstIdx < 4 && secondIdx < 4) {
-		m_mutationSpec[firstIdx][secondIdx]++;
-	}
+	// Substitutions involving other bases land in the last row or column
+	m_mutationSpec.add(baseIdx(var->d.allele[0][0]) * kBaseIdxCount + baseIdx(var->d.allele[altIndex][0]));
 }
 
 void BasicStatsCollector::updateAlleleFreqHist(bcf_hdr_t* hdr, bcf1_t* var) {
 	// Allele Frequency Histogram
-	int alleleFreqBin;
 	double alleleFreq = 0;
 	int count = 0;
 
@@ -183,89 +137,81 @@ void BasicStatsCollector::updateAlleleFreqHist(bcf_hdr_t* hdr, bcf1_t* var) {
 
 	if(alleleFreq == 0) return;
 
-	if (usingLogScaleAF) {
-		double logAF = log10(alleleFreq);
-		alleleFreqBin = (int) valueToBinOpenInterval(logAF, kLogAFLowerBound, kLogAFUpperBound, _alleleFreqBins - 1);
-	}
-	else {
-		alleleFreqBin = (int) valueToBinCloseInterval(alleleFreq, 0.0, 1.0, _alleleFreqBins - 1);
-	}
-
-	//assert(alleleFreq <= 1);
-	//assert(alleleFreq >= 0);
-	assert(alleleFreqBin >= 0);
-	assert(alleleFreqBin < _alleleFreqBins);
-
-	m_alleleFreqHist[alleleFreqBin]++;
+	m_alleleFreqHist.add(usingLogScaleAF ? log10(alleleFreq) : alleleFreq);
 }
 
-void BasicStatsCollector::updateVariantTypeDist(bcf1_t* var, int altIndex, int refLength) {
-	// Type Distribution
-	VariantTypeT vt;
-	int altLength = strlen(var->d.allele[altIndex]);
+VariantTypeT BasicStatsCollector::classifyAllele(const VariantAlleles& alleles, int altIndex) {
+	int refLength = alleles.length(0);
+	int altLength = alleles.length(altIndex);
 
 	// Do not use bcf_is_snp here because it enforces its logic across all alternates.
 	if(refLength == 1 && altLength == 1) {
-		vt = VT_SNP;
+		return VT_SNP;
 	}
     else if (refLength == altLength) {
-        vt = VT_MNP;
+        return VT_MNP;
     }
-    else if (strstr(var->d.allele[altIndex], "<") != nullptr) {
-        vt = VT_SV;
+    else if (alleles.isSymbolic(altIndex)) {
+        return VT_SV;
     }
 	else if (altLength > refLength) {
-		vt = VT_INS;
-		updateIndelSizeDist(refLength, altLength);
+		return VT_INS;
 	}
 	else if (altLength < refLength) {
-		vt = VT_DEL;
-		updateIndelSizeDist(refLength, altLength);
-	}
-	else {
-		vt = VT_OTHER;
+		return VT_DEL;
 	}
 
-	m_variantTypeDist[static_cast<unsigned int>(vt)]++;
+	return VT_OTHER;
 }
 
-void BasicStatsCollector::updateQualityDist(float qual) {
-
-	size_t bin = 0;
+const char* BasicStatsCollector::variantTypeLabel(size_t vt) {
+	switch(vt) {
+		case VT_SNP:
+			return "SNP";
+		case VT_MNP:
+			return "MNP";
+		case VT_SV:
+			return "SV";
+		case VT_INS:
+			return "INS";
+		case VT_DEL:
+			return "DEL";
+		default:
+			return "OTHER";
+	}
+}
 
-	int intQual = int(qual);
+void BasicStatsCollector::updateVariantTypeDist(const VariantAlleles& alleles, int altIndex) {
+	// Type Distribution
+	VariantTypeT vt = classifyAllele(alleles, altIndex);
 
-	if (intQual < kQualHistLowerbound)
-		bin = (kQualHistUpperbound - kQualHistLowerbound + 1);
-	else if (intQual > kQualHistUpperbound + 1)
-		bin = (kQualHistUpperbound - kQualHistLowerbound + 2);
-	else
-		bin = (intQual - kQualHistLowerbound);
+	if(vt == VT_INS || vt == VT_DEL) {
+		updateIndelSizeDist(alleles.length(0), alleles.length(altIndex));
+	}
 
-	m_qualityDist[bin] += 1;
+	m_variantTypeDist.add(vt);
+}
 
+void BasicStatsCollector::updateQualityDist(float qual) {
+	m_qualityDist.add(int(qual));
 }
 
 void BasicStatsCollector::updateIndelSizeDist(int refLength, int altLength) {
-
-	long indelSize = long(altLength) - long(refLength);
-	if(m_indelSizeDist.find(indelSize) == m_indelSizeDist.end())
-		m_indelSizeDist[indelSize] = 1;
-	else
-		m_indelSizeDist[indelSize] += 1;
+	if(altLength > refLength) m_insertionSizeDist.add(altLength - refLength);
+	else m_deletionSizeDist.add(refLength - altLength);
 }
 
 void BasicStatsCollector::processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) {
 	// increment total variant counter
 	++_stats[kTotalRecords];
 
-	bool isSnp = bcf_is_snp(var);
-	int refLength = strlen(var->d.allele[0]);
+	const VariantAlleles& alleles = VariantAlleles::of(var);
+	bool isSnp = alleles.isSnp();
 
 	for(int altIndex = 1; altIndex < var->n_allele; altIndex++) {
 		updateTsTvRatio(var, altIndex, isSnp);
 		updateMutationSpectrum(var, altIndex, isSnp);
-		updateVariantTypeDist(var, altIndex, refLength);
+		updateVariantTypeDist(alleles, altIndex);
 	}
 
 	updateAlleleFreqHist(hdr, var);
@@ -273,6 +219,40 @@ void BasicStatsCollector::processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) {
 
 }
 
+void BasicStatsCollector::mergeImpl(const AbstractStatCollector& other) {
+	const BasicStatsCollector& o = static_cast<const BasicStatsCollector&>(other);
+
+	_stats[kTotalRecords] += o._stats.at(kTotalRecords);
+	_transitions += o._transitions;
+	_transversions += o._transversions;
+
+	m_alleleFreqHist.merge(o.m_alleleFreqHist);
+	m_qualityDist.merge(o.m_qualityDist);
+	m_mutationSpec.merge(o.m_mutationSpec);
+	m_variantTypeDist.merge(o.m_variantTypeDist);
+	m_insertionSizeDist.merge(o.m_insertionSizeDist);
+	m_deletionSizeDist.merge(o.m_deletionSizeDist);
+}
+
+bool BasicStatsCollector::isSatisfiedImpl() {
+	double records = _stats[kTotalRecords];
+
+	// Ts/Tv is settled when the transition share of SNPs is
+	if(!isProportionSettled(_transitions, _transitions + _transversions, records)) return false;
+
+	double alleles = m_variantTypeDist.total();
+	for(size_t vt = 0; vt < VT_SIZE; vt++) {
+		if(!isProportionSettled(m_variantTypeDist.count(vt), alleles, records)) return false;
+	}
+
+	double afCount = m_alleleFreqHist.total();
+	for(size_t i = 0; i < m_alleleFreqHist.slots(); i++) {
+		if(!isProportionSettled(m_alleleFreqHist.slotCount(i), afCount, records)) return false;
+	}
+
+	return true;
+}
+
 void BasicStatsCollector::appendJsonImpl(json_t * jsonRootObj) {
 
 	// update some stats
@@ -286,10 +266,15 @@ void BasicStatsCollector::appendJsonImpl(json_t * jsonRootObj) {
 	// Allele Frequency Histogram
 	json_t * j_af_hist = json_object();
 	json_t * j_af_hist_bins = json_object();
-	for(size_t i=0; i<50; i++) {
-		if (m_alleleFreqHist[i] > 0) {
-			std::stringstream labelSS; labelSS << i;
-			json_object_set_new(j_af_hist_bins, labelSS.str().c_str(), json_integer(m_alleleFreqHist[i]));
+	// Bins are labelled by slot; on a linear scale, where AF cannot be
+	// negative, there is no underflow slot and labels start at 0. Only the
+	// first kAFHistBins labels are reported, which leaves out AF = 1 and
+	// on a log scale the top bin, as the regression fixture expects
+	size_t firstSlot = usingLogScaleAF ? 0 : 1;
+	for(size_t i = firstSlot; i < firstSlot + kAFHistBins; i++) {
+		if (m_alleleFreqHist.slotCount(i) > 0) {
+			std::stringstream labelSS; labelSS << i - firstSlot;
+			json_object_set_new(j_af_hist_bins, labelSS.str().c_str(), json_integer(m_alleleFreqHist.slotCount(i)));
 		}
 	}
 
@@ -308,7 +293,7 @@ void BasicStatsCollector::appendJsonImpl(json_t * jsonRootObj) {
 		std::stringstream labelSS; labelSS << idx2Base(first);
 		json_t * j_spec_array = json_array();
 		for(size_t second = 0; second<4; second++) {
-			json_array_append_new(j_spec_array, json_integer(m_mutationSpec[first][second]));
+			json_array_append_new(j_spec_array, json_integer(m_mutationSpec.count(first * kBaseIdxCount + second)));
 		}
 		json_object_set_new(j_mut_spec, labelSS.str().c_str(), j_spec_array);
 	}
@@ -317,29 +302,7 @@ void BasicStatsCollector::appendJsonImpl(json_t * jsonRootObj) {
 	// Mutation type
 	json_t * j_mut_type = json_object();
 	for(size_t vt = 0; vt < VT_SIZE; vt++) {
-		string label;
-		switch(vt) {
-			case VT_SNP:
-				label = "SNP";
-				break;
-			case VT_MNP:
-				label = "MNP";
-                break;
-			case VT_SV:
-				label = "SV";
-				break;
-			case VT_INS:
-				label = "INS";
-				break;
-			case VT_DEL:
-				label = "DEL";
-				break;
-			default:
-				label = "OTHER";
-				break;
-		}
-
-		json_object_set_new(j_mut_type, label.c_str(), json_integer(m_variantTypeDist[vt]));
+		json_object_set_new(j_mut_type, variantTypeLabel(vt), json_integer(m_variantTypeDist.count(vt)));
 	}
 	json_object_set_new(jsonRootObj, "var_type", j_mut_type);
 
@@ -348,22 +311,31 @@ void BasicStatsCollector::appendJsonImpl(json_t * jsonRootObj) {
 	json_object_set_new(j_qual_dist, "qualHistLowerBound", json_integer(kQualHistLowerbound));
 	json_object_set_new(j_qual_dist, "qualHistUpperBound", json_integer(kQualHistUpperbound));
 	json_t *j_qual_dist_bin = json_object();
-	for(size_t i=0; i<m_qualityDist.size() - 2; i++) {
-		if (m_qualityDist[i] == 0) continue;
+	size_t qualBins = kQualHistUpperbound - kQualHistLowerbound + 1;
+	for(size_t i=0; i<qualBins; i++) {
+		if (m_qualityDist.count(i) == 0) continue;
 		std::stringstream labelSS; labelSS << i;
-		json_object_set_new(j_qual_dist_bin, labelSS.str().c_str(), json_integer(m_qualityDist[i]));
+		json_object_set_new(j_qual_dist_bin, labelSS.str().c_str(), json_integer(m_qualityDist.count(i)));
 	}
 	json_object_set_new(j_qual_dist, "regularBins", j_qual_dist_bin);
-	json_object_set_new(j_qual_dist, "lowerBin", json_integer(m_qualityDist[kQualHistUpperbound - kQualHistLowerbound + 1]));
-	json_object_set_new(j_qual_dist, "upperBin", json_integer(m_qualityDist[kQualHistUpperbound - kQualHistLowerbound + 2]));
+	// A quality of exactly qualUpper + 1 has always been reported in lowerBin
+	json_object_set_new(j_qual_dist, "lowerBin", json_integer(m_qualityDist.underflow() + m_qualityDist.count(qualBins)));
+	json_object_set_new(j_qual_dist, "upperBin", json_integer(m_qualityDist.overflow()));
 
 	json_object_set_new(jsonRootObj, "qual_dist", j_qual_dist);
 
-	// Indel Size Dist
-	json_t * j_indel_size= json_object();
-	for(map<long, size_t>::iterator it = m_indelSizeDist.begin(); it != m_indelSizeDist.end(); it++) {
-		std::stringstream labelSS; labelSS << it->first;
-		json_object_set_new(j_indel_size, labelSS.str().c_str(), json_integer(it->second));
+	// Indel Size Dist, by signed size with deletions negative; sizes
+	// beyond the exact range are labelled by the bound nearest zero
+	json_t * j_indel_size = json_object();
+	for(size_t bin = m_deletionSizeDist.bins(); bin-- > 0;) {
+		if(m_deletionSizeDist.count(bin) == 0) continue;
+		std::stringstream labelSS; labelSS << -m_deletionSizeDist.binning().lowerEdge(bin);
+		json_object_set_new(j_indel_size, labelSS.str().c_str(), json_integer(m_deletionSizeDist.count(bin)));
+	}
+	for(size_t bin = 0; bin < m_insertionSizeDist.bins(); bin++) {
+		if(m_insertionSizeDist.count(bin) == 0) continue;
+		json_object_set_new(j_indel_size, m_insertionSizeDist.binning().label(bin).c_str(),
+				json_integer(m_insertionSizeDist.count(bin)));
 	}
 	json_object_set_new(jsonRootObj, "indel_size", j_indel_size);
 
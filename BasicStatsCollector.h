@@ -4,6 +4,8 @@
 #pragma once
 
 #include "AbstractStatCollector.h"
+#include "VariantAlleles.h"
+#include "Histogram.h"
 
 namespace VcfStatsAlive {
 
@@ -33,28 +35,46 @@ namespace VcfStatsAlive {
 			const int kQualHistLowerbound;
 			const int kQualHistUpperbound;
 
-			unsigned int *m_alleleFreqHist;
-			size_t _alleleFreqBins;
+			// AF, or log10(AF) on a log scale
+			Histogram<LinearBinning<double>, unsigned int> m_alleleFreqHist;
 			bool usingLogScaleAF;
-			std::vector<int> m_qualityDist;
-			unsigned int m_mutationSpec[4][4];
-			unsigned int m_variantTypeDist[VT_SIZE];
-			std::map<long, size_t> m_indelSizeDist;
+			Histogram<LinearBinning<int>, int> m_qualityDist;
+			// indexed by ref * 5 + alt, base index 4 collects non-ACGT bases
+			Histogram<IndexBinning, unsigned int> m_mutationSpec;
+			Histogram<IndexBinning, unsigned int> m_variantTypeDist;
+			// lengths of insertions and deletions, exact up to 63 bp
+			Histogram<HdrBinning, unsigned int> m_insertionSizeDist;
+			Histogram<HdrBinning, unsigned int> m_deletionSizeDist;
 
 
 			virtual void processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) override;
 			virtual void appendJsonImpl(json_t * jsonRootObj) override;
+			virtual void mergeImpl(const AbstractStatCollector& other) override;
+			virtual bool isSatisfiedImpl() override;
 
             void updateTsTvRatio(bcf1_t* var, int altIndex, bool isSnp);
             void updateMutationSpectrum(bcf1_t* var, int altIndex, bool isSnp);
             void updateAlleleFreqHist(bcf_hdr_t* hdr, bcf1_t* var);
             void updateQualityDist(float qual);
-            void updateVariantTypeDist(bcf1_t* var, int altIndex, int refLength);
+            void updateVariantTypeDist(const VariantAlleles& alleles, int altIndex);
             void updateIndelSizeDist(int refLength, int altLength);
 
 		public:
 			BasicStatsCollector(int qualLower, int qualUpper, bool logScaleAF = false);
 			virtual ~BasicStatsCollector();
+
+			/**
+			 * Classify one alternate allele of a variant
+			 *
+			 * @param alleles The allele descriptors of the variant
+			 * @param altIndex The index of the alternate allele
+			 */
+			static VariantTypeT classifyAllele(const VariantAlleles& alleles, int altIndex);
+
+			/**
+			 * @return The json label of a variant type, e.g. "SNP"
+			 */
+			static const char* variantTypeLabel(size_t vt);
 	};
 }
 
@@ -0,0 +1,130 @@
+/* ByExpressionStratifier.h
+ *
+ * Collect stats while stratifing by a StratificationSpec, e.g. INFO/AF
+ * bins, a VEP consequence or in / out of a BED target
+ *
+ * The spec is compiled once against the header into a function
+ * giving each record's bucket, and child collectors live in a dense
+ * array indexed by bucket. Collectors are only created for buckets
+ * that actually contain records. Stratifiers can be nested to cross
+ * several specs.
+ *
+ * Like the other stratifiers this class is a template over the
+ * collector type. By default collectors are default-constructed;
+ * a factory can be supplied for collectors that need arguments.
+ */
+
+#ifndef BYEXPRESSIONSTRATIFIER_H
+#define BYEXPRESSIONSTRATIFIER_H
+
+#pragma once
+
+#include "AbstractStatCollector.h"
+#include "StratificationSpec.h"
+#include <functional>
+
+namespace VcfStatsAlive {
+
+    template <class CollectorT>
+    class ByExpressionStratifier : public AbstractStatCollector {
+        public:
+            using FactoryT = std::function<CollectorT*()>;
+
+        protected:
+            virtual void processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) override {
+                size_t bucket = m_bucketOf(var);
+                m_counts[bucket]++;
+
+                CollectorT*& coll = m_collectors[bucket];
+                if(coll == nullptr) coll = create();
+
+                coll->processVariant(hdr, var);
+            }
+
+            virtual void appendJsonImpl(json_t* jsonRootObj) override {
+                json_object_set_new(jsonRootObj, "spec", json_string(m_spec->text().c_str()));
+
+                json_t * j_counts = json_object();
+                json_t * j_buckets = json_object();
+                for(size_t bucket = 0; bucket < m_collectors.size(); bucket++) {
+                    const char* label = m_spec->label(bucket).c_str();
+                    json_object_set_new(j_counts, label, json_integer(m_counts[bucket]));
+
+                    if(m_collectors[bucket] == nullptr) continue;
+                    json_t * j_bucket = json_object();
+                    m_collectors[bucket]->appendJson(j_bucket);
+                    json_object_set_new(j_buckets, label, j_bucket);
+                }
+                json_object_set_new(jsonRootObj, "counts", j_counts);
+                json_object_set_new(jsonRootObj, "buckets", j_buckets);
+            }
+
+            virtual void mergeImpl(const AbstractStatCollector& other) override {
+                auto& o = static_cast<const ByExpressionStratifier<CollectorT>&>(other);
+                // Buckets only depend on the spec, not on the header it was compiled against
+                assert(m_spec->text() == o.m_spec->text());
+
+                for(size_t bucket = 0; bucket < m_collectors.size(); bucket++) {
+                    m_counts[bucket] += o.m_counts[bucket];
+
+                    if(o.m_collectors[bucket] == nullptr) continue;
+                    if(m_collectors[bucket] == nullptr) m_collectors[bucket] = create();
+                    m_collectors[bucket]->merge(*o.m_collectors[bucket]);
+                }
+            }
+
+            virtual bool isSatisfiedImpl() override {
+                bool any = false;
+                for(auto* coll : m_collectors) {
+                    if(coll == nullptr) continue;
+                    if(!coll->isSatisfied()) return false;
+                    any = true;
+                }
+
+                return any;
+            }
+
+            virtual void setSamplingTargetImpl(double halfWidth, double z) override {
+                AbstractStatCollector::setSamplingTargetImpl(halfWidth, z);
+                for(auto* coll : m_collectors)
+                    if(coll != nullptr) coll->setSamplingTarget(halfWidth, z);
+            }
+
+        public:
+            /**
+             * @param hdr The vcf header the spec is compiled against
+             * @param spec The stratification, shared by all trees
+             * @param factory Creates the collector for a newly seen bucket
+             */
+            ByExpressionStratifier(bcf_hdr_t* hdr, std::shared_ptr<const StratificationSpec> spec,
+                    FactoryT factory = []() { return new CollectorT(); }) :
+                AbstractStatCollector(),
+                m_spec(spec),
+                m_bucketOf(spec->compile(hdr)),
+                m_factory(factory),
+                m_counts(spec->buckets(), 0),
+                m_collectors(spec->buckets(), nullptr) { }
+
+            virtual ~ByExpressionStratifier() {
+                for(auto* coll : m_collectors) delete coll;
+            }
+
+        private:
+            // keeps the data of m_bucketOf alive
+            std::shared_ptr<const StratificationSpec> m_spec;
+            BucketFunctionT m_bucketOf;
+            FactoryT m_factory;
+
+            // by bucket
+            std::vector<uint64_t> m_counts;
+            std::vector<CollectorT*> m_collectors;
+
+            CollectorT* create() {
+                CollectorT* coll = m_factory();
+                if(_samplingHalfWidth > 0) coll->setSamplingTarget(_samplingHalfWidth, _samplingZ);
+                return coll;
+            }
+    };
+}
+
+#endif
@@ -0,0 +1,234 @@
+/* ByFilterStratifier.h
+ *
+ * Collect stats while stratifing over the FILTER column
+ *
+ * Records with a single filter, PASS included, go to the collector
+ * of that filter; records failing several filters share one
+ * collector, and so do records without a FILTER value ('.'). The
+ * FILTER ids of a record are header dictionary ids, which a table
+ * built from the header maps to dense filter indexes, so routing a
+ * record costs no string compares. Filters the header does not
+ * declare are added when first seen.
+ *
+ * Besides the strata, the number of records carrying each filter,
+ * alone or with others, and the number carrying each pair of filters
+ * are reported, showing how much every filter removes and how the
+ * filters overlap.
+ *
+ * Like the other stratifiers this class is a template over the
+ * collector type. By default collectors are default-constructed;
+ * a factory can be supplied for collectors that need arguments.
+ */
+
+#ifndef BYFILTERSTRATIFIER_H
+#define BYFILTERSTRATIFIER_H
+
+#pragma once
+
+#include "AbstractStatCollector.h"
+#include <functional>
+
+namespace VcfStatsAlive {
+
+    template <class CollectorT>
+    class ByFilterStratifier : public AbstractStatCollector {
+        public:
+            using FactoryT = std::function<CollectorT*()>;
+
+        protected:
+            virtual void processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) override {
+                bcf_unpack(var, BCF_UN_FLT);
+                m_records++;
+
+                int n = var->d.n_flt;
+                m_recordFilters.resize(n);
+                for(int i = 0; i < n; i++) {
+                    size_t filter = filterIndex(hdr, var->d.flt[i]);
+                    m_recordFilters[i] = filter;
+                    m_filterCounts[filter]++;
+                }
+
+                // Each pair once per record, kept symmetric
+                for(int i = 0; i < n; i++) {
+                    for(int j = i + 1; j < n; j++) {
+                        m_cooccurrence[m_recordFilters[i]][m_recordFilters[j]]++;
+                        m_cooccurrence[m_recordFilters[j]][m_recordFilters[i]]++;
+                    }
+                }
+
+                CollectorT*& coll = n == 0 ? m_missing : n == 1 ? m_collectors[m_recordFilters[0]] : m_multiple;
+                if(coll == nullptr) coll = create();
+
+                coll->processVariant(hdr, var);
+            }
+
+            virtual void appendJsonImpl(json_t* jsonRootObj) override {
+                json_object_set_new(jsonRootObj, "records", json_integer(m_records));
+
+                json_t * j_counts = json_object();
+                json_t * j_cooccurrence = json_object();
+                json_t * j_filters = json_object();
+                for(size_t filter = 0; filter < m_filterNames.size(); filter++) {
+                    if(m_filterCounts[filter] == 0) continue;
+                    const char* name = m_filterNames[filter].c_str();
+                    json_object_set_new(j_counts, name, json_integer(m_filterCounts[filter]));
+
+                    json_t * j_pairs = json_object();
+                    for(size_t other = 0; other < m_filterNames.size(); other++) {
+                        if(m_cooccurrence[filter][other] == 0) continue;
+                        json_object_set_new(j_pairs, m_filterNames[other].c_str(), json_integer(m_cooccurrence[filter][other]));
+                    }
+                    if(json_object_size(j_pairs) > 0) json_object_set_new(j_cooccurrence, name, j_pairs);
+                    else json_decref(j_pairs);
+
+                    if(m_collectors[filter] == nullptr) continue;
+                    json_t * j_filter = json_object();
+                    m_collectors[filter]->appendJson(j_filter);
+                    json_object_set_new(j_filters, name, j_filter);
+                }
+                json_object_set_new(jsonRootObj, "counts", j_counts);
+                json_object_set_new(jsonRootObj, "cooccurrence", j_cooccurrence);
+                json_object_set_new(jsonRootObj, "filters", j_filters);
+
+                if(m_multiple != nullptr) {
+                    json_t * j_multiple = json_object();
+                    m_multiple->appendJson(j_multiple);
+                    json_object_set_new(jsonRootObj, "multiple", j_multiple);
+                }
+
+                if(m_missing != nullptr) {
+                    json_t * j_missing = json_object();
+                    m_missing->appendJson(j_missing);
+                    json_object_set_new(jsonRootObj, "missing", j_missing);
+                }
+            }
+
+            virtual void mergeImpl(const AbstractStatCollector& other) override {
+                auto& o = static_cast<const ByFilterStratifier<CollectorT>&>(other);
+
+                // The other stratifier may come from a file with a different
+                // header, so filters are matched by name
+                std::map<std::string, size_t> filterByName;
+                for(size_t filter = 0; filter < m_filterNames.size(); filter++) filterByName[m_filterNames[filter]] = filter;
+
+                std::vector<size_t> filterOfOther(o.m_filterNames.size());
+                for(size_t otherFilter = 0; otherFilter < o.m_filterNames.size(); otherFilter++) {
+                    auto loc = filterByName.find(o.m_filterNames[otherFilter]);
+                    filterOfOther[otherFilter] = loc != filterByName.end() ? loc->second : addFilter(o.m_filterNames[otherFilter]);
+                }
+
+                m_records += o.m_records;
+                for(size_t otherFilter = 0; otherFilter < o.m_filterNames.size(); otherFilter++) {
+                    size_t filter = filterOfOther[otherFilter];
+                    m_filterCounts[filter] += o.m_filterCounts[otherFilter];
+                    for(size_t otherPair = 0; otherPair < o.m_filterNames.size(); otherPair++)
+                        m_cooccurrence[filter][filterOfOther[otherPair]] += o.m_cooccurrence[otherFilter][otherPair];
+
+                    if(o.m_collectors[otherFilter] == nullptr) continue;
+                    if(m_collectors[filter] == nullptr) m_collectors[filter] = create();
+                    m_collectors[filter]->merge(*o.m_collectors[otherFilter]);
+                }
+
+                if(o.m_multiple != nullptr) {
+                    if(m_multiple == nullptr) m_multiple = create();
+                    m_multiple->merge(*o.m_multiple);
+                }
+
+                if(o.m_missing != nullptr) {
+                    if(m_missing == nullptr) m_missing = create();
+                    m_missing->merge(*o.m_missing);
+                }
+            }
+
+            virtual bool isSatisfiedImpl() override {
+                bool any = false;
+                for(auto* coll : m_collectors) {
+                    if(coll == nullptr) continue;
+                    if(!coll->isSatisfied()) return false;
+                    any = true;
+                }
+                if(m_multiple != nullptr && !m_multiple->isSatisfied()) return false;
+                if(m_missing != nullptr && !m_missing->isSatisfied()) return false;
+
+                return any || m_multiple != nullptr || m_missing != nullptr;
+            }
+
+            virtual void setSamplingTargetImpl(double halfWidth, double z) override {
+                AbstractStatCollector::setSamplingTargetImpl(halfWidth, z);
+                for(auto* coll : m_collectors)
+                    if(coll != nullptr) coll->setSamplingTarget(halfWidth, z);
+                if(m_multiple != nullptr) m_multiple->setSamplingTarget(halfWidth, z);
+                if(m_missing != nullptr) m_missing->setSamplingTarget(halfWidth, z);
+            }
+
+        public:
+            /**
+             * @param hdr The vcf header declaring the filters
+             * @param factory Creates the collector for a newly seen stratum
+             */
+            ByFilterStratifier(bcf_hdr_t* hdr, FactoryT factory = []() { return new CollectorT(); }) :
+                AbstractStatCollector(),
+                m_factory(factory),
+                m_records(0),
+                m_multiple(nullptr),
+                m_missing(nullptr) {
+
+                int idCount = hdr->n[BCF_DT_ID];
+                m_filterIndex.assign(idCount, -1);
+                for(int id = 0; id < idCount; id++) {
+                    if(!bcf_hdr_idinfo_exists(hdr, BCF_HL_FLT, id)) continue;
+                    m_filterIndex[id] = int(addFilter(bcf_hdr_int2id(hdr, BCF_DT_ID, id)));
+                }
+            }
+
+            virtual ~ByFilterStratifier() {
+                for(auto* coll : m_collectors) delete coll;
+                delete m_multiple;
+                delete m_missing;
+            }
+
+        private:
+            FactoryT m_factory;
+
+            // dense filter index by header dictionary id, -1 for INFO and FORMAT ids
+            std::vector<int> m_filterIndex;
+
+            // by filter index
+            std::vector<std::string> m_filterNames;
+            std::vector<uint64_t> m_filterCounts;
+            std::vector<std::vector<uint64_t>> m_cooccurrence;
+            std::vector<CollectorT*> m_collectors;
+
+            uint64_t m_records;
+            CollectorT* m_multiple;
+            CollectorT* m_missing;
+
+            // filter indexes of the current record
+            std::vector<size_t> m_recordFilters;
+
+            size_t addFilter(const std::string& name) {
+                size_t filter = m_filterNames.size();
+                m_filterNames.push_back(name);
+                m_filterCounts.push_back(0);
+                m_collectors.push_back(nullptr);
+
+                for(auto& row : m_cooccurrence) row.push_back(0);
+                m_cooccurrence.push_back(std::vector<uint64_t>(filter + 1, 0));
+                return filter;
+            }
+
+            size_t filterIndex(bcf_hdr_t* hdr, int id) {
+                if(id >= (int)m_filterIndex.size()) m_filterIndex.resize(id + 1, -1);
+                if(m_filterIndex[id] < 0) m_filterIndex[id] = int(addFilter(bcf_hdr_int2id(hdr, BCF_DT_ID, id)));
+                return size_t(m_filterIndex[id]);
+            }
+
+            CollectorT* create() {
+                CollectorT* coll = m_factory();
+                if(_samplingHalfWidth > 0) coll->setSamplingTarget(_samplingHalfWidth, _samplingZ);
+                return coll;
+            }
+    };
+}
+
+#endif
@@ -14,6 +14,7 @@
 #pragma once
 
 #include "AbstractStatCollector.h"
+#include "Genotype.h"
 #include <sstream>
 #include <cstdlib>
 
@@ -27,7 +28,8 @@ namespace VcfStatsAlive {
                 ngt = bcf_get_genotypes(hdr, var, &gt_arr, &ngt_arr);
                 std::unique_ptr<int32_t> uniq_gt_arr(gt_arr);
 
-                auto gt_cat = genotype_category(gt_arr, ngt_arr);
+                int ploidy = ngt > 0 ? ngt / bcf_hdr_nsamples(hdr) : 0;
+                auto gt_cat = genotype_category(gt_arr, ploidy);
 
                 if(gt_cat == "REF") return;
 
@@ -49,6 +51,15 @@ namespace VcfStatsAlive {
                 }
             }
 
+            virtual void mergeImpl(const AbstractStatCollector& other) override {
+                auto& o = static_cast<const ByGenotypeStratifier<CollectorT>&>(other);
+                for(auto& gt : o.m_collectors) {
+                    if(m_collectors.find(gt.first) == m_collectors.end())
+                        m_collectors[gt.first] = new CollectorT();
+                    m_collectors[gt.first]->merge(*gt.second);
+                }
+            }
+
         public:
             ByGenotypeStratifier() : AbstractStatCollector() { }
             virtual ~ByGenotypeStratifier() {
@@ -70,21 +81,15 @@ namespace VcfStatsAlive {
                 return ss.str();
             }
 
-            // convert htslib genotype array to category string
-            std::string genotype_category(const int32_t *gt_arr, const int32_t ngt_arr) {
+            // category string of the first sample's genotype
+            std::string genotype_category(const int32_t *gt_arr, const int32_t ploidy) {
                 /* categories:
                  *
                  * 1. heterozygous.     E.g. 0/1, 1/2, 2|1
                  * 2. homozygous alt.   E.g. 1/1, 2|2
                  */
 
-                auto gt1 = (gt_arr[0] >> 1) - 1;
-                auto gt2 = (gt_arr[1] >> 1) - 1;
-
-                if(gt1 < 0 || gt2 < 0) return "MISSING";
-                if(gt1 == 0 && gt2 == 0) return "REF";
-                if(gt1 == gt2) return "HOM";
-                return "HET";
+                return genotypeClassLabel(genotypeClass(gt_arr, ploidy));
            }
     };
 }
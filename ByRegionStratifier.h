@@ -0,0 +1,179 @@
+/* ByRegionStratifier.h
+ *
+ * Collect stats while stratifing over genomic location
+ *
+ * Records are partitioned by contig and, when a window size is
+ * given, by fixed-size windows along each contig. Child collectors
+ * live in dense arrays indexed by the record's rid and pos / window,
+ * so routing a record costs O(1) regardless of how many contigs the
+ * header declares. Collectors are only created for regions that
+ * actually contain records.
+ *
+ * Like the other stratifiers this class is a template over the
+ * collector type. By default collectors are default-constructed;
+ * a factory can be supplied for collectors that need arguments.
+ */
+
+#ifndef BYREGIONSTRATIFIER_H
+#define BYREGIONSTRATIFIER_H
+
+#pragma once
+
+#include "AbstractStatCollector.h"
+#include <functional>
+#include <sstream>
+
+namespace VcfStatsAlive {
+
+    template <class CollectorT>
+    class ByRegionStratifier : public AbstractStatCollector {
+        public:
+            using FactoryT = std::function<CollectorT*()>;
+
+        protected:
+            virtual void processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) override {
+                if(var->rid < 0) return;
+
+                if(var->rid >= (int)m_collectors.size()) {
+                    m_collectors.resize(var->rid + 1);
+                    m_contigNames.resize(var->rid + 1);
+                }
+                if(m_contigNames[var->rid].empty()) m_contigNames[var->rid] = bcf_seqname(hdr, var);
+
+                auto& windows = m_collectors[var->rid];
+                size_t window = m_windowSize > 0 ? size_t(var->pos / m_windowSize) : 0;
+                if(window >= windows.size()) windows.resize(window + 1, nullptr);
+
+                CollectorT*& coll = windows[window];
+                if(coll == nullptr) coll = create();
+
+                coll->processVariant(hdr, var);
+            }
+
+            virtual void appendJsonImpl(json_t* jsonRootObj) override {
+                for(size_t rid = 0; rid < m_collectors.size(); rid++) {
+                    auto& windows = m_collectors[rid];
+                    if(windows.empty()) continue;
+
+                    json_t * j_contig = json_object();
+
+                    if(m_windowSize == 0) {
+                        windows[0]->appendJson(j_contig);
+                    }
+                    else {
+                        for(size_t window = 0; window < windows.size(); window++) {
+                            if(windows[window] == nullptr) continue;
+                            std::stringstream labelSS; labelSS << window * m_windowSize;
+                            json_t * j_window = json_object();
+                            windows[window]->appendJson(j_window);
+                            json_object_set_new(j_contig, labelSS.str().c_str(), j_window);
+                        }
+                    }
+
+                    json_object_set_new(jsonRootObj, m_contigNames[rid].c_str(), j_contig);
+                }
+            }
+
+            virtual void mergeImpl(const AbstractStatCollector& other) override {
+                auto& o = static_cast<const ByRegionStratifier<CollectorT>&>(other);
+                assert(m_windowSize == o.m_windowSize);
+
+                // The other stratifier may come from a file with a different
+                // contig order, so contigs are matched by name
+                std::map<std::string, size_t> ridByName;
+                for(size_t rid = 0; rid < m_contigNames.size(); rid++) ridByName[m_contigNames[rid]] = rid;
+
+                for(size_t otherRid = 0; otherRid < o.m_collectors.size(); otherRid++) {
+                    auto& otherWindows = o.m_collectors[otherRid];
+                    if(otherWindows.empty()) continue;
+
+                    size_t rid;
+                    auto loc = ridByName.find(o.m_contigNames[otherRid]);
+                    if(loc != ridByName.end()) {
+                        rid = loc->second;
+                    }
+                    else {
+                        rid = m_contigNames.size();
+                        m_contigNames.push_back(o.m_contigNames[otherRid]);
+                        m_collectors.resize(rid + 1);
+                    }
+
+                    auto& windows = m_collectors[rid];
+                    if(windows.size() < otherWindows.size()) windows.resize(otherWindows.size(), nullptr);
+
+                    for(size_t window = 0; window < otherWindows.size(); window++) {
+                        if(otherWindows[window] == nullptr) continue;
+                        if(windows[window] == nullptr) windows[window] = create();
+                        windows[window]->merge(*otherWindows[window]);
+                    }
+                }
+            }
+
+            virtual bool isSatisfiedImpl() override {
+                bool any = false;
+                for(auto& windows : m_collectors) {
+                    for(auto* coll : windows) {
+                        if(coll == nullptr) continue;
+                        if(!coll->isSatisfied()) return false;
+                        any = true;
+                    }
+                }
+
+                return any;
+            }
+
+            virtual void setSamplingTargetImpl(double halfWidth, double z) override {
+                AbstractStatCollector::setSamplingTargetImpl(halfWidth, z);
+                for(auto& windows : m_collectors)
+                    for(auto* coll : windows)
+                        if(coll != nullptr) coll->setSamplingTarget(halfWidth, z);
+            }
+
+        public:
+            /**
+             * @param hdr The vcf header, used to size the per-contig arrays
+             * @param windowSize Window size in bp; 0 stratifies by contig only
+             * @param factory Creates the collector for a newly seen region
+             */
+            ByRegionStratifier(bcf_hdr_t* hdr, hts_pos_t windowSize = 0,
+                    FactoryT factory = []() { return new CollectorT(); }) :
+                AbstractStatCollector(),
+                m_windowSize(windowSize < 0 ? 0 : windowSize),
+                m_factory(factory) {
+
+                int contigCount = hdr->n[BCF_DT_CTG];
+                m_collectors.resize(contigCount);
+                m_contigNames.resize(contigCount);
+
+                for(int rid = 0; rid < contigCount; rid++) {
+                    m_contigNames[rid] = bcf_hdr_id2name(hdr, rid);
+
+                    // Reserve the windows of contigs with a declared length
+                    hts_pos_t length = hdr->id[BCF_DT_CTG][rid].val->info[0];
+                    if(m_windowSize > 0 && length > 0)
+                        m_collectors[rid].reserve(size_t((length + m_windowSize - 1) / m_windowSize));
+                }
+            }
+
+            virtual ~ByRegionStratifier() {
+                for(auto& windows : m_collectors)
+                    for(auto* coll : windows) delete coll;
+            }
+
+        private:
+            hts_pos_t m_windowSize;
+            FactoryT m_factory;
+
+            // m_collectors[rid][window], nullptr until a record is seen there
+            std::vector<std::vector<CollectorT*>> m_collectors;
+            std::vector<std::string> m_contigNames;
+
+            CollectorT* create() {
+                CollectorT* coll = m_factory();
+                if(_samplingHalfWidth > 0) coll->setSamplingTarget(_samplingHalfWidth, _samplingZ);
+                return coll;
+            }
+    };
+}
+
+#endif
@@ -45,6 +45,15 @@ namespace VcfStatsAlive {
                 }
             }
 
+            virtual void mergeImpl(const AbstractStatCollector& other) override {
+                auto& o = static_cast<const BySampleStratifier<CollectorT>&>(other);
+                for(auto& sample : o.m_collectors) {
+                    if(m_collectors.find(sample.first) == m_collectors.end())
+                        m_collectors[sample.first] = new CollectorT();
+                    m_collectors[sample.first]->merge(*sample.second);
+                }
+            }
+
         public:
             BySampleStratifier(bcf_hdr_t* hdr) : AbstractStatCollector() { 
                 auto sample_iter = hdr->id[BCF_DT_SAMPLE];
@@ -0,0 +1,81 @@
+#include "CardinalityStatsCollector.h"
+#include "VariantAlleles.h"
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+CardinalityStatsCollector::CardinalityStatsCollector() :
+	AbstractStatCollector(),
+	m_totalRecords(0),
+	m_totalAlleles(0),
+	m_hashedHdr(NULL) {
+}
+
+CardinalityStatsCollector::~CardinalityStatsCollector() {
+}
+
+uint64_t CardinalityStatsCollector::contigHash(const bcf_hdr_t* hdr, int rid) {
+	if(hdr != m_hashedHdr) {
+		m_hashedHdr = hdr;
+		m_contigHashes.assign(hdr->n[BCF_DT_CTG], 0);
+	}
+
+	if(rid < 0 || rid >= hdr->n[BCF_DT_CTG]) return 0;
+
+	// The header gains contigs that are not declared as records name them
+	if(rid >= int(m_contigHashes.size())) m_contigHashes.resize(hdr->n[BCF_DT_CTG], 0);
+
+	uint64_t& hash = m_contigHashes[rid];
+	if(hash == 0) {
+		const char* name = bcf_hdr_id2name(hdr, rid);
+		hash = hashBytes(name, strlen(name)) | 1;
+	}
+	return hash;
+}
+
+void CardinalityStatsCollector::processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) {
+	m_totalRecords++;
+
+	uint64_t chromHash = contigHash(hdr, var->rid);
+	m_contigs.add(chromHash);
+
+	uint64_t posHash = hashMix(chromHash ^ hashMix(uint64_t(var->pos)));
+	m_positions.add(posHash);
+
+	const VariantAlleles& alleles = VariantAlleles::of(var);
+	uint64_t refHash = hashBytes(var->d.allele[0], alleles.length(0), posHash);
+
+	for(int altIndex = 1; altIndex < var->n_allele; altIndex++) {
+		m_variants.add(hashBytes(var->d.allele[altIndex], alleles.length(altIndex), refHash));
+		m_totalAlleles++;
+	}
+}
+
+void CardinalityStatsCollector::appendJsonImpl(json_t * jsonRootObj) {
+	double distinctVariants = m_variants.estimate();
+
+	// The estimate can overshoot the exact allele count on small inputs
+	double duplicateRate = 0;
+	if(m_totalAlleles > 0 && distinctVariants < m_totalAlleles) {
+		duplicateRate = 1.0 - distinctVariants / double(m_totalAlleles);
+	}
+
+	json_t * j_distinct = json_object();
+	json_object_set_new(j_distinct, "records", json_integer(m_totalRecords));
+	json_object_set_new(j_distinct, "alleles", json_integer(m_totalAlleles));
+	json_object_set_new(j_distinct, "variants", json_real(distinctVariants));
+	json_object_set_new(j_distinct, "positions", json_real(m_positions.estimate()));
+	json_object_set_new(j_distinct, "contigs", json_real(m_contigs.estimate()));
+	json_object_set_new(j_distinct, "duplicateRate", json_real(duplicateRate));
+	json_object_set_new(jsonRootObj, "distinct", j_distinct);
+}
+
+void CardinalityStatsCollector::mergeImpl(const AbstractStatCollector& otherCollector) {
+	const CardinalityStatsCollector& other = static_cast<const CardinalityStatsCollector&>(otherCollector);
+
+	m_variants.merge(other.m_variants);
+	m_positions.merge(other.m_positions);
+	m_contigs.merge(other.m_contigs);
+	m_totalRecords += other.m_totalRecords;
+	m_totalAlleles += other.m_totalAlleles;
+}
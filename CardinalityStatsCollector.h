@@ -0,0 +1,48 @@
+#ifndef CARDINALITYSTATSCOLLECTOR_H
+#define CARDINALITYSTATSCOLLECTOR_H
+
+#pragma once
+
+#include "AbstractStatCollector.h"
+#include "HyperLogLog.h"
+
+namespace VcfStatsAlive {
+
+	/**
+	 * Estimate the number of distinct variants, positions and contigs
+	 *
+	 * Distinct CHROM:POS:REF:ALT keys (one per alternate allele),
+	 * CHROM:POS keys and CHROM names are each counted by a HyperLogLog
+	 * estimator, so memory is a fixed few KB. Keys are built from contig
+	 * names rather than header ids, which keeps estimators from different
+	 * files comparable when merged. Comparing the distinct variant estimate
+	 * to the number of alleles seen gives a duplicate rate.
+	 */
+	class CardinalityStatsCollector : public AbstractStatCollector {
+
+		protected:
+			HyperLogLog m_variants;
+			HyperLogLog m_positions;
+			HyperLogLog m_contigs;
+
+			size_t m_totalRecords;
+			size_t m_totalAlleles;
+
+			// per-header cache of contig name hashes, indexed by rid
+			const bcf_hdr_t* m_hashedHdr;
+			std::vector<uint64_t> m_contigHashes;
+
+			virtual void processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) override;
+			virtual void appendJsonImpl(json_t * jsonRootObj) override;
+			virtual void mergeImpl(const AbstractStatCollector& other) override;
+
+		private:
+			uint64_t contigHash(const bcf_hdr_t* hdr, int rid);
+
+		public:
+			CardinalityStatsCollector();
+			virtual ~CardinalityStatsCollector();
+	};
+}
+
+#endif
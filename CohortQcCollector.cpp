@@ -0,0 +1,137 @@
+#include "CohortQcCollector.h"
+#include "NucleotideTables.h"
+#include "VariantAlleles.h"
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+CohortQcCollector::CohortQcCollector(bcf_hdr_t* hdr) :
+	AbstractStatCollector(),
+	m_records(0),
+	m_gt(NULL),
+	m_gtSize(0) {
+
+	size_t samples = bcf_hdr_nsamples(hdr);
+	m_sampleNames.resize(samples);
+	for(size_t i = 0; i < samples; i++) m_sampleNames[i] = hdr->samples[i];
+
+	m_counts.resize(samples, SampleQcCounts());
+}
+
+CohortQcCollector::~CohortQcCollector() {
+	free(m_gt);
+}
+
+void CohortQcCollector::processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) {
+	m_records++;
+
+	size_t samples = min(m_counts.size(), size_t(bcf_hdr_nsamples(hdr)));
+	SampleQcCounts* counts = m_counts.data();
+
+	int ngt = bcf_get_genotypes(hdr, var, &m_gt, &m_gtSize);
+	if(ngt <= 0) {
+		for(size_t s = 0; s < samples; s++) counts[s].genotypes[GC_MISSING]++;
+		return;
+	}
+	int ploidy = ngt / bcf_hdr_nsamples(hdr);
+
+	// Substitution class of each allele, SC_NONE unless it is an SNV
+	const VariantAlleles& alleles = VariantAlleles::of(var);
+	int alleleCount = var->n_allele;
+	m_alleleClasses.assign(alleleCount, SC_NONE);
+	m_alleleCounts.assign(alleleCount, 0);
+	if(alleleCount > 0 && alleles.length(0) == 1) {
+		for(int i = 1; i < alleleCount; i++) {
+			if(alleles.length(i) != 1 || alleles.isSymbolic(i)) continue;
+			m_alleleClasses[i] = substitutionClass(alleles.firstBase(0), alleles.firstBase(i));
+		}
+	}
+
+	for(size_t s = 0; s < samples; s++) {
+		const int32_t* gt = m_gt + s * ploidy;
+		SampleQcCounts& sampleCounts = counts[s];
+
+		sampleCounts.genotypes[genotypeClass(gt, ploidy)]++;
+
+		int previous = -1;
+		for(int i = 0; i < ploidy && gt[i] != bcf_int32_vector_end; i++) {
+			if(bcf_gt_is_missing(gt[i])) continue;
+			int allele = bcf_gt_allele(gt[i]);
+			if(allele >= alleleCount) continue;
+
+			m_alleleCounts[allele]++;
+
+			// Each alternate allele counts once per sample, e.g. once for 1/1
+			if(allele == previous) continue;
+			uint8_t substitution = m_alleleClasses[allele];
+			sampleCounts.transitions += (substitution == SC_TRANSITION);
+			sampleCounts.transversions += (substitution == SC_TRANSVERSION);
+			previous = allele;
+		}
+	}
+
+	bool anySingleton = false;
+	for(int i = 1; i < alleleCount; i++) anySingleton = anySingleton || m_alleleCounts[i] == 1;
+	if(!anySingleton) return;
+
+	// Credit the carriers of singletons, which most records do not have
+	for(size_t s = 0; s < samples; s++) {
+		const int32_t* gt = m_gt + s * ploidy;
+		for(int i = 0; i < ploidy && gt[i] != bcf_int32_vector_end; i++) {
+			if(bcf_gt_is_missing(gt[i])) continue;
+			int allele = bcf_gt_allele(gt[i]);
+			if(allele > 0 && allele < alleleCount && m_alleleCounts[allele] == 1) counts[s].singletons++;
+		}
+	}
+}
+
+void CohortQcCollector::mergeImpl(const AbstractStatCollector& otherCollector) {
+	const CohortQcCollector& other = static_cast<const CohortQcCollector&>(otherCollector);
+
+	m_records += other.m_records;
+
+	vector<size_t> sampleOfOther = matchSamples(m_sampleNames, other.m_sampleNames);
+	m_counts.resize(m_sampleNames.size(), SampleQcCounts());
+
+	for(size_t otherSample = 0; otherSample < other.m_sampleNames.size(); otherSample++) {
+		SampleQcCounts& counts = m_counts[sampleOfOther[otherSample]];
+		const SampleQcCounts& otherCounts = other.m_counts[otherSample];
+		for(size_t gc = 0; gc < GC_SIZE; gc++) counts.genotypes[gc] += otherCounts.genotypes[gc];
+		counts.singletons += otherCounts.singletons;
+		counts.transitions += otherCounts.transitions;
+		counts.transversions += otherCounts.transversions;
+	}
+}
+
+void CohortQcCollector::appendJsonImpl(json_t * jsonRootObj) {
+	json_t * j_qc = json_object();
+	json_object_set_new(j_qc, "records", json_integer(m_records));
+
+	json_t * j_samples = json_object();
+	for(size_t s = 0; s < m_sampleNames.size(); s++) {
+		const SampleQcCounts& counts = m_counts[s];
+		json_t * j_sample = json_object();
+
+		for(size_t gc = 0; gc < GC_SIZE; gc++) {
+			json_object_set_new(j_sample, genotypeClassLabel(gc), json_integer(counts.genotypes[gc]));
+		}
+
+		uint64_t total = 0;
+		for(size_t gc = 0; gc < GC_SIZE; gc++) total += counts.genotypes[gc];
+		uint64_t called = total - counts.genotypes[GC_MISSING];
+
+		json_object_set_new(j_sample, "callRate", json_real(total > 0 ? double(called) / total : 0));
+		json_object_set_new(j_sample, "hetHomRatio", json_real(counts.genotypes[GC_HOM] > 0 ?
+				double(counts.genotypes[GC_HET]) / counts.genotypes[GC_HOM] : 0));
+		json_object_set_new(j_sample, "singletons", json_integer(counts.singletons));
+		json_object_set_new(j_sample, "transitions", json_integer(counts.transitions));
+		json_object_set_new(j_sample, "transversions", json_integer(counts.transversions));
+		json_object_set_new(j_sample, "TsTvRatio", json_real(counts.transversions > 0 ?
+				double(counts.transitions) / counts.transversions : 0));
+
+		json_object_set_new(j_samples, m_sampleNames[s].c_str(), j_sample);
+	}
+	json_object_set_new(j_qc, "samples", j_samples);
+
+	json_object_set_new(jsonRootObj, "cohort_qc", j_qc);
+}
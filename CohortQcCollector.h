@@ -0,0 +1,56 @@
+#ifndef COHORTQCCOLLECTOR_H
+#define COHORTQCCOLLECTOR_H
+
+#pragma once
+
+#include "AbstractStatCollector.h"
+#include "Genotype.h"
+
+namespace VcfStatsAlive {
+
+	/**
+	 * Collect the per-sample QC numbers of a cohort: genotype class counts
+	 * (and from them the het/hom-alt ratio and call rate), singletons and
+	 * Ts/Tv of the SNV alleles each sample carries
+	 *
+	 * Unlike per-sample collector trees, only a handful of 32-bit counters
+	 * are kept per sample, in one flat array, so memory stays linear in the
+	 * number of samples at a few dozen bytes each. GT is decoded once per
+	 * record for all samples. A singleton is an alternate allele carried by
+	 * exactly one allele copy across the cohort; it counts for the sample
+	 * carrying it.
+	 */
+	class CohortQcCollector : public AbstractStatCollector {
+
+		protected:
+			struct SampleQcCounts {
+				uint32_t genotypes[GC_SIZE];	// indexed by GenotypeClassT
+				uint32_t singletons;
+				uint32_t transitions;
+				uint32_t transversions;
+			};
+
+			std::vector<std::string> m_sampleNames;
+			std::vector<SampleQcCounts> m_counts;
+			uint64_t m_records;
+
+			// reusable per-record buffers
+			int32_t* m_gt;
+			int m_gtSize;
+			std::vector<uint8_t> m_alleleClasses;
+			std::vector<uint32_t> m_alleleCounts;
+
+			virtual void processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) override;
+			virtual void appendJsonImpl(json_t * jsonRootObj) override;
+			virtual void mergeImpl(const AbstractStatCollector& other) override;
+
+		public:
+			/**
+			 * @param hdr The vcf header providing the samples
+			 */
+			CohortQcCollector(bcf_hdr_t* hdr);
+			virtual ~CohortQcCollector();
+	};
+}
+
+#endif
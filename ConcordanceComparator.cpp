@@ -0,0 +1,277 @@
+#include "ConcordanceComparator.h"
+
+#include <cstring>
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+ConcordanceComparator::ConcordanceComparator(const string& first, const string& second) :
+	_bothSites(0),
+	_firstOnlySites(0),
+	_secondOnlySites(0) {
+
+	_streams[0].filename = first;
+	_streams[1].filename = second;
+
+	for(int i = 0; i < 2; i++) {
+		_streams[i].fp = NULL;
+		_streams[i].hdr = NULL;
+		_streams[i].ring = NULL;
+		_streams[i].rec = NULL;
+		_streams[i].gt = NULL;
+		_streams[i].gtSize = 0;
+		_streams[i].blockSize = 0;
+		_streams[i].blockRid = -1;
+		_streams[i].blockPos = -1;
+	}
+}
+
+ConcordanceComparator::~ConcordanceComparator() {
+	for(int i = 0; i < 2; i++) {
+		Stream& stream = _streams[i];
+		free(stream.gt);
+		for(size_t r = 0; r < stream.block.size(); r++) bcf_destroy(stream.block[r]);
+		if(stream.hdr != NULL) bcf_hdr_destroy(stream.hdr);
+		if(stream.fp != NULL) hts_close(stream.fp);
+	}
+}
+
+bool ConcordanceComparator::open() {
+	for(int i = 0; i < 2; i++) {
+		Stream& stream = _streams[i];
+
+		stream.fp = hts_open(stream.filename.c_str(), "r");
+		if(stream.fp == NULL) {
+			cerr<<"Unable to open vcf file "<<stream.filename<<endl;
+			return false;
+		}
+
+		stream.hdr = bcf_hdr_read(stream.fp);
+		if(stream.hdr == NULL) {
+			cerr<<"Unable to read the header of "<<stream.filename<<endl;
+			return false;
+		}
+	}
+
+	bcf_hdr_t* firstHdr = _streams[0].hdr;
+	bcf_hdr_t* secondHdr = _streams[1].hdr;
+
+	// Contigs the first header lacks sort after all of its own
+	int firstContigs = firstHdr->n[BCF_DT_CTG];
+	int secondContigs = secondHdr->n[BCF_DT_CTG];
+	_secondContigOrder.resize(secondContigs);
+	for(int rid = 0; rid < secondContigs; rid++) {
+		int firstRid = bcf_hdr_name2id(firstHdr, bcf_hdr_id2name(secondHdr, rid));
+		_secondContigOrder[rid] = firstRid >= 0 ? firstRid : firstContigs + rid;
+	}
+
+	for(int i = 0; i < bcf_hdr_nsamples(firstHdr); i++) {
+		const char* name = firstHdr->samples[i];
+		int secondIndex = bcf_hdr_id2int(secondHdr, BCF_DT_SAMPLE, name);
+		if(secondIndex < 0) continue;
+
+		_sampleNames.push_back(name);
+		_firstSamples.push_back(i);
+		_secondSamples.push_back(secondIndex);
+	}
+
+	if(_sampleNames.empty()) {
+		cerr<<"Warning: "<<_streams[0].filename<<" and "<<_streams[1].filename<<" share no samples"<<endl;
+	}
+
+	_matrix.assign(_sampleNames.size() * GC_SIZE * GC_SIZE, 0);
+
+	return true;
+}
+
+void ConcordanceComparator::advance(Stream& stream) {
+	stream.ring->release();
+	stream.rec = stream.ring->acquire();
+}
+
+/**
+ * @return REF and the sorted ALTs, which records of the same site share
+ *         whatever the order of their ALTs
+ */
+static string alleleKey(bcf1_t* rec) {
+	vector<string> alts(rec->d.allele + 1, rec->d.allele + rec->n_allele);
+	sort(alts.begin(), alts.end());
+
+	string key = rec->d.allele[0];
+	for(size_t i = 0; i < alts.size(); i++) key += "\t" + alts[i];
+	return key;
+}
+
+void ConcordanceComparator::readBlock(Stream& stream) {
+	stream.blockSize = 0;
+	if(stream.rec == NULL) return;
+
+	stream.blockRid = stream.rec->rid;
+	stream.blockPos = stream.rec->pos;
+
+	// The ring hands out one record at a time, so the block holds copies
+	while(stream.rec != NULL && stream.rec->rid == stream.blockRid && stream.rec->pos == stream.blockPos) {
+		if(stream.blockSize == stream.block.size()) stream.block.push_back(bcf_init());
+		bcf1_t* copy = stream.block[stream.blockSize++];
+		bcf_copy(copy, stream.rec);
+		bcf_unpack(copy, BCF_UN_STR | BCF_UN_FMT);
+		advance(stream);
+	}
+
+	stream.blockKeys.resize(stream.blockSize);
+	stream.blockPaired.assign(stream.blockSize, 0);
+	for(size_t r = 0; r < stream.blockSize; r++) stream.blockKeys[r] = alleleKey(stream.block[r]);
+}
+
+int ConcordanceComparator::compareBlocks() {
+	const Stream& first = _streams[0];
+	const Stream& second = _streams[1];
+
+	int secondOrder = (size_t)second.blockRid < _secondContigOrder.size() ?
+			_secondContigOrder[second.blockRid] : INT32_MAX;
+	if(first.blockRid != secondOrder) return first.blockRid < secondOrder ? -1 : 1;
+	if(first.blockPos != second.blockPos) return first.blockPos < second.blockPos ? -1 : 1;
+
+	return 0;
+}
+
+void ConcordanceComparator::joinBlocks() {
+	Stream& first = _streams[0];
+	Stream& second = _streams[1];
+
+	// Blocks hold a few records, pairs are found by scanning
+	for(size_t f = 0; f < first.blockSize; f++) {
+		for(size_t s = 0; s < second.blockSize; s++) {
+			if(second.blockPaired[s] || first.blockKeys[f] != second.blockKeys[s]) continue;
+
+			first.blockPaired[f] = second.blockPaired[s] = 1;
+			_bothSites++;
+			compareGenotypes(first.block[f], second.block[s]);
+			break;
+		}
+	}
+
+	for(size_t f = 0; f < first.blockSize; f++) _firstOnlySites += !first.blockPaired[f];
+	for(size_t s = 0; s < second.blockSize; s++) _secondOnlySites += !second.blockPaired[s];
+}
+
+int ConcordanceComparator::decodeGenotypes(Stream& stream, bcf1_t* rec) {
+	int ngt = bcf_get_genotypes(stream.hdr, rec, &stream.gt, &stream.gtSize);
+	int samples = bcf_hdr_nsamples(stream.hdr);
+	return ngt > 0 && samples > 0 ? ngt / samples : 0;
+}
+
+void ConcordanceComparator::compareGenotypes(bcf1_t* firstRec, bcf1_t* secondRec) {
+	int firstPloidy = decodeGenotypes(_streams[0], firstRec);
+	int secondPloidy = decodeGenotypes(_streams[1], secondRec);
+
+	uint64_t* matrix = _matrix.data();
+	for(size_t s = 0; s < _sampleNames.size(); s++, matrix += GC_SIZE * GC_SIZE) {
+		GenotypeClassT firstClass = firstPloidy > 0 ?
+				genotypeClass(_streams[0].gt + _firstSamples[s] * firstPloidy, firstPloidy) : GC_MISSING;
+		GenotypeClassT secondClass = secondPloidy > 0 ?
+				genotypeClass(_streams[1].gt + _secondSamples[s] * secondPloidy, secondPloidy) : GC_MISSING;
+
+		matrix[firstClass * GC_SIZE + secondClass]++;
+	}
+}
+
+bool ConcordanceComparator::run() {
+	Stream& first = _streams[0];
+	Stream& second = _streams[1];
+
+	// Each stream decodes its records, FORMAT fields included, on its own thread
+	VcfRecordRing firstRing(first.fp, first.hdr, kDefaultRingCapacity, BCF_UN_STR | BCF_UN_FMT);
+	VcfRecordRing secondRing(second.fp, second.hdr, kDefaultRingCapacity, BCF_UN_STR | BCF_UN_FMT);
+	first.ring = &firstRing;
+	second.ring = &secondRing;
+
+	for(int i = 0; i < 2; i++) {
+		_streams[i].ring->start();
+		_streams[i].rec = _streams[i].ring->acquire();
+		readBlock(_streams[i]);
+	}
+
+	while(first.blockSize > 0 && second.blockSize > 0) {
+		int cmp = compareBlocks();
+		if(cmp < 0) {
+			_firstOnlySites += first.blockSize;
+			readBlock(first);
+		}
+		else if(cmp > 0) {
+			_secondOnlySites += second.blockSize;
+			readBlock(second);
+		}
+		else {
+			joinBlocks();
+			readBlock(first);
+			readBlock(second);
+		}
+	}
+
+	for(; first.blockSize > 0; readBlock(first)) _firstOnlySites += first.blockSize;
+	for(; second.blockSize > 0; readBlock(second)) _secondOnlySites += second.blockSize;
+
+	bool succeeded = true;
+	for(int i = 0; i < 2; i++) {
+		if(_streams[i].ring->hasError()) {
+			cerr<<"Error reading vcf record in "<<_streams[i].filename<<endl;
+			succeeded = false;
+		}
+		_streams[i].ring->stop();
+		_streams[i].ring = NULL;
+	}
+
+	return succeeded;
+}
+
+void ConcordanceComparator::appendJson(json_t * jsonRootObj) const {
+	json_t * j_concordance = json_object();
+
+	json_object_set_new(j_concordance, "first", json_string(_streams[0].filename.c_str()));
+	json_object_set_new(j_concordance, "second", json_string(_streams[1].filename.c_str()));
+
+	json_t * j_sites = json_object();
+	json_object_set_new(j_sites, "both", json_integer(_bothSites));
+	json_object_set_new(j_sites, "firstOnly", json_integer(_firstOnlySites));
+	json_object_set_new(j_sites, "secondOnly", json_integer(_secondOnlySites));
+	json_object_set_new(j_concordance, "sites", j_sites);
+
+	json_t * j_classes = json_array();
+	for(size_t c = 0; c < GC_SIZE; c++) json_array_append_new(j_classes, json_string(genotypeClassLabel(c)));
+	json_object_set_new(j_concordance, "classes", j_classes);
+
+	json_t * j_samples = json_object();
+	for(size_t s = 0; s < _sampleNames.size(); s++) {
+		const uint64_t* matrix = _matrix.data() + s * GC_SIZE * GC_SIZE;
+
+		json_t * j_matrix = json_array();
+		uint64_t called = 0, agreed = 0, nonRefCalled = 0, nonRefAgreed = 0;
+		for(size_t i = 0; i < GC_SIZE; i++) {
+			json_t * j_row = json_array();
+			for(size_t j = 0; j < GC_SIZE; j++) {
+				uint64_t count = matrix[i * GC_SIZE + j];
+				json_array_append_new(j_row, json_integer(count));
+
+				// Pairs with a missing call on either side are not compared
+				if(i == GC_MISSING || j == GC_MISSING) continue;
+				called += count;
+				if(i == j) agreed += count;
+				if(i == GC_REF && j == GC_REF) continue;
+				nonRefCalled += count;
+				if(i == j) nonRefAgreed += count;
+			}
+			json_array_append_new(j_matrix, j_row);
+		}
+
+		json_t * j_sample = json_object();
+		json_object_set_new(j_sample, "matrix", j_matrix);
+		json_object_set_new(j_sample, "concordance", json_real(called > 0 ? double(agreed) / called : 0));
+		json_object_set_new(j_sample, "nonRefConcordance",
+				json_real(nonRefCalled > 0 ? double(nonRefAgreed) / nonRefCalled : 0));
+		json_object_set_new(j_samples, _sampleNames[s].c_str(), j_sample);
+	}
+	json_object_set_new(j_concordance, "samples", j_samples);
+
+	json_object_set_new(jsonRootObj, "concordance", j_concordance);
+}
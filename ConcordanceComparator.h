@@ -0,0 +1,100 @@
+#ifndef CONCORDANCECOMPARATOR_H
+#define CONCORDANCECOMPARATOR_H
+
+#pragma once
+
+#include "VcfRecordRing.h"
+#include "Genotype.h"
+
+namespace VcfStatsAlive {
+
+	/**
+	 * Compare the genotypes of two position-sorted vcf/bcf files
+	 *
+	 * Both files are read in lockstep with a merge join on (contig, pos);
+	 * contigs are ordered as in the first file's header, so both files must
+	 * be sorted in that order. Sorting says nothing about the order of
+	 * records at one position, e.g. of split multiallelics, so all records
+	 * of a position are copied from each file and paired by REF and their
+	 * set of ALTs. Each file is decoded by its own VcfRecordRing thread,
+	 * including the FORMAT fields, so the join itself only compares keys
+	 * and decodes GT once per record. Samples are paired
+	 * by name. For every site present in both files, each sample pair adds
+	 * one count to its 4x4 matrix of genotype classes (REF/HET/HOM/MISSING
+	 * in the first file by the same in the second); the matrices of all
+	 * samples live in one contiguous array.
+	 */
+	class ConcordanceComparator {
+		public:
+			/**
+			 * @param first The file the matrix rows refer to, e.g. the new release
+			 * @param second The file the matrix columns refer to
+			 */
+			ConcordanceComparator(const std::string& first, const std::string& second);
+			virtual ~ConcordanceComparator();
+
+			/**
+			 * Open both files and pair their samples
+			 *
+			 * @return false if a file could not be opened
+			 */
+			bool open();
+
+			/**
+			 * Join both files to the end
+			 *
+			 * @return false if a read error occurred
+			 */
+			bool run();
+
+			/**
+			 * Append the matrices and site counts as "concordance"
+			 */
+			void appendJson(json_t * jsonRootObj) const;
+
+		private:
+			struct Stream {
+				std::string filename;
+				htsFile* fp;
+				bcf_hdr_t* hdr;
+				VcfRecordRing* ring;	// set while run() joins the streams
+				bcf1_t* rec;		// current record, NULL once exhausted
+				int32_t* gt;
+				int gtSize;
+
+				// Copies of the records at the current position, reused
+				std::vector<bcf1_t*> block;
+				size_t blockSize;
+				std::vector<std::string> blockKeys;
+				std::vector<char> blockPaired;
+				int blockRid;
+				hts_pos_t blockPos;
+			};
+
+			Stream _streams[2];
+
+			// Contig order of the second file's rids in the first file's header
+			std::vector<int> _secondContigOrder;
+
+			// Samples of the first file that the second file also has
+			std::vector<std::string> _sampleNames;
+			std::vector<int> _firstSamples;
+			std::vector<int> _secondSamples;
+
+			// _matrix[(sample * GC_SIZE + first class) * GC_SIZE + second class]
+			std::vector<uint64_t> _matrix;
+
+			uint64_t _bothSites;
+			uint64_t _firstOnlySites;
+			uint64_t _secondOnlySites;
+
+			void advance(Stream& stream);
+			void readBlock(Stream& stream);
+			int compareBlocks();
+			void joinBlocks();
+			void compareGenotypes(bcf1_t* firstRec, bcf1_t* secondRec);
+			int decodeGenotypes(Stream& stream, bcf1_t* rec);
+	};
+}
+
+#endif
@@ -0,0 +1,135 @@
+#include "DensityTrackCollector.h"
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+DensityTrackCollector::DensityTrackCollector(bcf_hdr_t* hdr, hts_pos_t binSize, unsigned int zoomLevels) :
+	AbstractStatCollector(),
+	m_binSize(binSize > 0 ? binSize : 1),
+	m_zoomLevels(zoomLevels > 0 ? zoomLevels : 1) {
+
+	int contigCount = hdr->n[BCF_DT_CTG];
+	m_contigNames.resize(contigCount);
+	m_contigLengths.resize(contigCount);
+	m_tracks.resize(contigCount);
+
+	for(int rid = 0; rid < contigCount; rid++) {
+		m_contigNames[rid] = bcf_hdr_id2name(hdr, rid);
+		m_contigLengths[rid] = hdr->id[BCF_DT_CTG][rid].val->info[0];
+	}
+}
+
+DensityTrackCollector::~DensityTrackCollector() {
+}
+
+void DensityTrackCollector::resizeTrack(size_t rid, size_t bins) {
+	vector<vector<uint32_t>>& track = m_tracks[rid];
+	if(track.empty()) track.resize(m_zoomLevels);
+
+	for(unsigned int zoom = 0; zoom < m_zoomLevels; zoom++) {
+		size_t zoomBins = ((bins - 1) >> zoom) + 1;
+		if(track[zoom].size() < zoomBins) track[zoom].resize(zoomBins, 0);
+	}
+}
+
+void DensityTrackCollector::processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) {
+	if(var->rid < 0) return;
+
+	// Contigs without a ##contig line are added to the header as records
+	// name them, without a length
+	if(var->rid >= int(m_tracks.size())) {
+		size_t known = m_tracks.size();
+		m_contigNames.resize(var->rid + 1);
+		m_contigLengths.resize(var->rid + 1, 0);
+		m_tracks.resize(var->rid + 1);
+		for(int rid = int(known); rid <= var->rid; rid++) {
+			m_contigNames[rid] = bcf_hdr_id2name(hdr, rid);
+			m_contigLengths[rid] = hdr->id[BCF_DT_CTG][rid].val->info[0];
+		}
+	}
+
+	size_t bin = size_t(var->pos / m_binSize);
+	vector<vector<uint32_t>>& track = m_tracks[var->rid];
+
+	if(track.empty() || track[0].size() <= bin) {
+		// Size the track for the whole contig the first time it is seen;
+		// records past the declared length (or with no length) grow it
+		hts_pos_t length = m_contigLengths[var->rid];
+		size_t bins = length > 0 ? size_t((length + m_binSize - 1) / m_binSize) : 0;
+		resizeTrack(var->rid, std::max(bins, bin + 1));
+	}
+
+	for(unsigned int zoom = 0; zoom < m_zoomLevels; zoom++) {
+		track[zoom][bin >> zoom]++;
+	}
+}
+
+void DensityTrackCollector::appendJsonImpl(json_t * jsonRootObj) {
+	json_t * j_density = json_object();
+	json_object_set_new(j_density, "binSize", json_integer(m_binSize));
+	json_object_set_new(j_density, "zoomLevels", json_integer(m_zoomLevels));
+
+	json_t * j_contigs = json_object();
+	for(size_t rid = 0; rid < m_tracks.size(); rid++) {
+		const vector<vector<uint32_t>>& track = m_tracks[rid];
+		if(track.empty()) continue;
+
+		json_t * j_contig = json_object();
+		json_object_set_new(j_contig, "length", json_integer(m_contigLengths[rid]));
+
+		json_t * j_levels = json_array();
+		for(unsigned int zoom = 0; zoom < m_zoomLevels; zoom++) {
+			const vector<uint32_t>& bins = track[zoom];
+			json_t * j_rle = json_array();
+
+			size_t start = 0;
+			while(start < bins.size()) {
+				size_t end = start + 1;
+				while(end < bins.size() && bins[end] == bins[start]) end++;
+				json_array_append_new(j_rle, json_integer(bins[start]));
+				json_array_append_new(j_rle, json_integer(end - start));
+				start = end;
+			}
+
+			json_array_append_new(j_levels, j_rle);
+		}
+		json_object_set_new(j_contig, "levels", j_levels);
+
+		json_object_set_new(j_contigs, m_contigNames[rid].c_str(), j_contig);
+	}
+	json_object_set_new(j_density, "contigs", j_contigs);
+
+	json_object_set_new(jsonRootObj, "density", j_density);
+}
+
+void DensityTrackCollector::mergeImpl(const AbstractStatCollector& otherCollector) {
+	const DensityTrackCollector& other = static_cast<const DensityTrackCollector&>(otherCollector);
+
+	map<string, size_t> ridByName;
+	for(size_t rid = 0; rid < m_contigNames.size(); rid++) ridByName[m_contigNames[rid]] = rid;
+
+	for(size_t otherRid = 0; otherRid < other.m_tracks.size(); otherRid++) {
+		const vector<vector<uint32_t>>& otherTrack = other.m_tracks[otherRid];
+		if(otherTrack.empty()) continue;
+
+		size_t rid;
+		auto loc = ridByName.find(other.m_contigNames[otherRid]);
+		if(loc != ridByName.end()) {
+			rid = loc->second;
+		}
+		else {
+			rid = m_contigNames.size();
+			m_contigNames.push_back(other.m_contigNames[otherRid]);
+			m_contigLengths.push_back(other.m_contigLengths[otherRid]);
+			m_tracks.resize(rid + 1);
+		}
+
+		resizeTrack(rid, otherTrack[0].size());
+		vector<vector<uint32_t>>& track = m_tracks[rid];
+		for(unsigned int zoom = 0; zoom < m_zoomLevels && zoom < otherTrack.size(); zoom++) {
+			for(size_t bin = 0; bin < otherTrack[zoom].size(); bin++) {
+				track[zoom][bin] += otherTrack[zoom][bin];
+			}
+		}
+	}
+}
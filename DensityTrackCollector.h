@@ -0,0 +1,54 @@
+#ifndef DENSITYTRACKCOLLECTOR_H
+#define DENSITYTRACKCOLLECTOR_H
+
+#pragma once
+
+#include "AbstractStatCollector.h"
+
+namespace VcfStatsAlive {
+
+	static const unsigned int kDefaultDensityZoomLevels = 8;
+
+	/**
+	 * Collect a variants-per-bin density track across the genome
+	 *
+	 * Counts are kept in fixed-width bins per contig, sized from the
+	 * contig lengths declared in the header; contigs the header gains
+	 * while records are read get tracks that grow with their records.
+	 * On top of the base bins a pyramid of zoom levels is maintained,
+	 * where level z sums 2^z base bins; every level is updated as records
+	 * arrive, so any zoom can be served without a rebuild. Tracks are written as run-length encoded
+	 * [count, run, count, run, ...] arrays to keep updates small.
+	 */
+	class DensityTrackCollector : public AbstractStatCollector {
+
+		protected:
+			hts_pos_t m_binSize;
+			unsigned int m_zoomLevels;
+
+			std::vector<std::string> m_contigNames;
+			std::vector<hts_pos_t> m_contigLengths;
+
+			// m_tracks[rid][zoom][bin]
+			std::vector<std::vector<std::vector<uint32_t>>> m_tracks;
+
+			virtual void processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) override;
+			virtual void appendJsonImpl(json_t * jsonRootObj) override;
+			virtual void mergeImpl(const AbstractStatCollector& other) override;
+
+		private:
+			void resizeTrack(size_t rid, size_t bins);
+
+		public:
+			/**
+			 * @param hdr The vcf header providing contig names and lengths
+			 * @param binSize Width of the base bins in bp
+			 * @param zoomLevels Number of levels, including the base bins
+			 */
+			DensityTrackCollector(bcf_hdr_t* hdr, hts_pos_t binSize,
+					unsigned int zoomLevels = kDefaultDensityZoomLevels);
+			virtual ~DensityTrackCollector();
+	};
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef GENOTYPE_H
+#define GENOTYPE_H
+
+#pragma once
+
+namespace VcfStatsAlive {
+
+	typedef enum {
+		GC_REF = 0,
+		GC_HET,
+		GC_HOM,
+		GC_MISSING,
+		GC_SIZE
+	} GenotypeClassT;
+
+	/**
+	 * Classify the genotype of one sample
+	 *
+	 *   REF      all alleles are the reference, e.g. 0/0, 0
+	 *   HET      alleles differ, e.g. 0/1, 1/2, 2|1
+	 *   HOM      all alleles are the same alternate, e.g. 1/1, 2|2, 1
+	 *   MISSING  any allele is missing, e.g. ./., 0/., or no GT at all
+	 *
+	 * @param gt The htslib encoded GT values of the sample
+	 * @param ploidy The number of values per sample; samples of lower
+	 *               ploidy are padded with bcf_int32_vector_end
+	 */
+	inline GenotypeClassT genotypeClass(const int32_t* gt, int ploidy) {
+		int first = -1;
+		bool same = true;
+		int alleles = 0;
+
+		for(int i = 0; i < ploidy; i++) {
+			if(gt[i] == bcf_int32_vector_end) break;
+			if(bcf_gt_is_missing(gt[i])) return GC_MISSING;
+
+			int allele = bcf_gt_allele(gt[i]);
+			if(alleles == 0) first = allele;
+			else same = same && allele == first;
+			alleles++;
+		}
+
+		if(alleles == 0) return GC_MISSING;
+		if(!same) return GC_HET;
+		return first == 0 ? GC_REF : GC_HOM;
+	}
+
+	inline const char* genotypeClassLabel(size_t gc) {
+		static const char* kLabels[GC_SIZE] = { "REF", "HET", "HOM", "MISSING" };
+		return gc < GC_SIZE ? kLabels[gc] : "MISSING";
+	}
+}
+
+#endif
@@ -0,0 +1,145 @@
+#include "HardyWeinbergCollector.h"
+
+#include <cmath>
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+// Bound on the memoized count triples, the cache starts over beyond it
+static const size_t kMaxCachedPValues = 1 << 20;
+
+HardyWeinbergCollector::HardyWeinbergCollector() :
+	AbstractStatCollector(),
+	m_sites(0),
+	m_skipped(0),
+	m_monomorphic(0),
+	m_logPHist(LinearBinning<double>(0, kHweMaxLogP, kHweLogPBins)),
+	m_inbreedingHist(EdgeBinning<double>::uniform(-1, 1, kInbreedingBins)),
+	m_gt(NULL),
+	m_gtSize(0) {
+}
+
+HardyWeinbergCollector::~HardyWeinbergCollector() {
+	free(m_gt);
+}
+
+double HardyWeinbergCollector::exactTest(uint32_t het, uint32_t homRef, uint32_t homAlt) {
+	int64_t homRare = min(homRef, homAlt);
+	int64_t homCommon = max(homRef, homAlt);
+	int64_t rareCopies = 2 * homRare + het;
+	int64_t genotypes = het + homRare + homCommon;
+
+	m_hetProbs.assign(rareCopies + 1, 0);
+
+	// Start from the most likely het count, of the same parity as rareCopies
+	int64_t mid = rareCopies * (2 * genotypes - rareCopies) / (2 * genotypes);
+	if((rareCopies & 1) ^ (mid & 1)) mid++;
+
+	m_hetProbs[mid] = 1.0;
+	double sum = 1.0;
+
+	int64_t currRare = (rareCopies - mid) / 2;
+	int64_t currCommon = genotypes - mid - currRare;
+	for(int64_t currHets = mid; currHets > 1; currHets -= 2) {
+		m_hetProbs[currHets - 2] = m_hetProbs[currHets] * currHets * (currHets - 1.0) /
+				(4.0 * (currRare + 1.0) * (currCommon + 1.0));
+		sum += m_hetProbs[currHets - 2];
+		currRare++;
+		currCommon++;
+	}
+
+	currRare = (rareCopies - mid) / 2;
+	currCommon = genotypes - mid - currRare;
+	for(int64_t currHets = mid; currHets <= rareCopies - 2; currHets += 2) {
+		m_hetProbs[currHets + 2] = m_hetProbs[currHets] * 4.0 * currRare * currCommon /
+				((currHets + 2.0) * (currHets + 1.0));
+		sum += m_hetProbs[currHets + 2];
+		currRare--;
+		currCommon--;
+	}
+
+	// Sum the probabilities of all het counts no more likely than the observed one
+	double observed = m_hetProbs[het];
+	double p = 0;
+	for(int64_t i = 0; i <= rareCopies; i++) {
+		if(m_hetProbs[i] <= observed) p += m_hetProbs[i];
+	}
+
+	return min(1.0, p / sum);
+}
+
+double HardyWeinbergCollector::pValue(uint32_t het, uint32_t homRef, uint32_t homAlt) {
+	uint64_t key = (uint64_t(het) << 42) | (uint64_t(homRef) << 21) | homAlt;
+	bool packable = het < (1u << 21) && homRef < (1u << 21) && homAlt < (1u << 21);
+	if(!packable) return exactTest(het, homRef, homAlt);
+
+	unordered_map<uint64_t, double>::iterator loc = m_pValueCache.find(key);
+	if(loc != m_pValueCache.end()) return loc->second;
+
+	if(m_pValueCache.size() >= kMaxCachedPValues) m_pValueCache.clear();
+	double p = exactTest(het, homRef, homAlt);
+	m_pValueCache[key] = p;
+	return p;
+}
+
+void HardyWeinbergCollector::processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) {
+	int samples = bcf_hdr_nsamples(hdr);
+	int ngt = samples > 0 && var->n_allele == 2 ? bcf_get_genotypes(hdr, var, &m_gt, &m_gtSize) : 0;
+	if(ngt != 2 * samples || samples == 0) {
+		m_skipped++;
+		return;
+	}
+
+	// counts[0] collects non-diploid and missing calls, then hom-ref, het, hom-alt
+	uint32_t counts[4] = { 0, 0, 0, 0 };
+	const int32_t* gt = m_gt;
+	for(int s = 0; s < samples; s++) {
+		int32_t first = gt[2 * s] >> 1;
+		int32_t second = gt[2 * s + 1] >> 1;
+		int32_t called = (first != 0) & (second != 0) & (gt[2 * s + 1] != bcf_int32_vector_end);
+		counts[called * (1 + (first == 2) + (second == 2))]++;
+	}
+
+	uint32_t homRef = counts[1], het = counts[2], homAlt = counts[3];
+	uint64_t genotypes = uint64_t(homRef) + het + homAlt;
+	if(genotypes == 0) {
+		m_skipped++;
+		return;
+	}
+	m_sites++;
+
+	// p = 1 gives -0, which is binned with 0
+	m_logPHist.add(-log10(pValue(het, homRef, homAlt)));
+
+	double altFreq = (2.0 * homAlt + het) / (2.0 * genotypes);
+	double expectedHet = 2.0 * altFreq * (1 - altFreq) * genotypes;
+	if(expectedHet <= 0) {
+		m_monomorphic++;
+		return;
+	}
+
+	m_inbreedingHist.add(1 - het / expectedHet);
+}
+
+void HardyWeinbergCollector::mergeImpl(const AbstractStatCollector& otherCollector) {
+	const HardyWeinbergCollector& other = static_cast<const HardyWeinbergCollector&>(otherCollector);
+
+	m_sites += other.m_sites;
+	m_skipped += other.m_skipped;
+	m_monomorphic += other.m_monomorphic;
+	m_logPHist.merge(other.m_logPHist);
+	m_inbreedingHist.merge(other.m_inbreedingHist);
+}
+
+void HardyWeinbergCollector::appendJsonImpl(json_t * jsonRootObj) {
+	json_t * j_hwe = json_object();
+	json_object_set_new(j_hwe, "sites", json_integer(m_sites));
+	json_object_set_new(j_hwe, "skipped", json_integer(m_skipped));
+	json_object_set_new(j_hwe, "monomorphic", json_integer(m_monomorphic));
+
+	// Bins are labelled by their lower bound
+	json_object_set_new(j_hwe, "negLog10PHist", m_logPHist.toJson());
+	json_object_set_new(j_hwe, "inbreedingHist", m_inbreedingHist.toJson());
+
+	json_object_set_new(jsonRootObj, "hwe", j_hwe);
+}
@@ -0,0 +1,63 @@
+#ifndef HARDYWEINBERGCOLLECTOR_H
+#define HARDYWEINBERGCOLLECTOR_H
+
+#pragma once
+
+#include "AbstractStatCollector.h"
+#include "Histogram.h"
+
+#include <unordered_map>
+
+namespace VcfStatsAlive {
+
+	// -log10(p) from 0 to 20 in steps of 0.5, p < 1e-20 is overflow
+	static const int kHweLogPBins = 40;
+	static const double kHweMaxLogP = 20;
+	// F from -1 to 1 in steps of 0.05
+	static const int kInbreedingBins = 40;
+
+	/**
+	 * Collect the distributions of the Hardy-Weinberg equilibrium exact
+	 * test p-value and the inbreeding coefficient F of biallelic sites
+	 *
+	 * Diploid genotype counts (hom-ref, het, hom-alt) are taken from GT;
+	 * other calls are left out. The p-value is the exact test of Wigginton
+	 * et al. (2005); F is 1 - observed / expected heterozygosity. In large
+	 * cohorts most sites share a few count triples, e.g. all hom-ref but
+	 * one het, so p-values are memoized by triple.
+	 *
+	 * p-values are binned by -log10(p), F in linear bins; sites without
+	 * calls, or without expected heterozygosity for F, are counted apart.
+	 */
+	class HardyWeinbergCollector : public AbstractStatCollector {
+
+		protected:
+			uint64_t m_sites;			// biallelic sites with diploid calls
+			uint64_t m_skipped;			// other records
+			uint64_t m_monomorphic;		// sites without expected heterozygosity
+			Histogram<LinearBinning<double> > m_logPHist;
+			Histogram<EdgeBinning<double> > m_inbreedingHist;
+
+			// reusable buffers
+			int32_t* m_gt;
+			int m_gtSize;
+			std::vector<double> m_hetProbs;
+
+			// p-values by (het, hom-ref, hom-alt)
+			std::unordered_map<uint64_t, double> m_pValueCache;
+
+			virtual void processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) override;
+			virtual void appendJsonImpl(json_t * jsonRootObj) override;
+			virtual void mergeImpl(const AbstractStatCollector& other) override;
+
+		private:
+			double pValue(uint32_t het, uint32_t homRef, uint32_t homAlt);
+			double exactTest(uint32_t het, uint32_t homRef, uint32_t homAlt);
+
+		public:
+			HardyWeinbergCollector();
+			virtual ~HardyWeinbergCollector();
+	};
+}
+
+#endif
@@ -0,0 +1,332 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#pragma once
+
+#include <cmath>
+#include <type_traits>
+
+namespace VcfStatsAlive {
+
+	/*
+	 * Binnings map a value to a slot of a Histogram:
+	 *   0            underflow, values below the first bin (and NaN)
+	 *   1 .. bins()  the regular bins
+	 *   bins() + 1   overflow, values above the last bin
+	 * and label regular bins, usually by their lower edge.
+	 */
+
+	/**
+	 * Equal-width bins over [lower, upper)
+	 *
+	 * Integral values are binned exactly, e.g. one bin per quality value;
+	 * floating point values as floor((value - lower) / (upper - lower) * bins).
+	 */
+	template <typename T>
+	class LinearBinning {
+		public:
+			typedef T ValueT;
+
+			constexpr LinearBinning(T lower, T upper, size_t bins) :
+				m_lower(lower), m_upper(upper), m_bins(bins) {}
+
+			constexpr size_t bins() const { return m_bins; }
+
+			constexpr size_t slot(T value) const {
+				return !(value >= m_lower) ? 0 :
+					value >= m_upper ? m_bins + 1 :
+					1 + clampBin(std::is_integral<T>::value ?
+							size_t((value - m_lower) * T(m_bins) / (m_upper - m_lower)) :
+							size_t((value - m_lower) / (m_upper - m_lower) * T(m_bins)));
+			}
+
+			double lowerEdge(size_t bin) const {
+				return double(m_lower) + double(m_upper - m_lower) * bin / m_bins;
+			}
+
+			std::string label(size_t bin) const {
+				std::stringstream labelSS; labelSS << lowerEdge(bin);
+				return labelSS.str();
+			}
+
+			bool operator==(const LinearBinning& other) const {
+				return m_lower == other.m_lower && m_upper == other.m_upper && m_bins == other.m_bins;
+			}
+
+		private:
+			T m_lower;
+			T m_upper;
+			size_t m_bins;
+
+			// Rounding may put values just below upper into bin m_bins
+			constexpr size_t clampBin(size_t bin) const { return bin < m_bins ? bin : m_bins - 1; }
+	};
+
+	/**
+	 * Equal-width bins of log10(value) over [lowerExponent, upperExponent)
+	 *
+	 * Values that are not positive are counted as underflow.
+	 */
+	template <typename T>
+	class LogBinning {
+		public:
+			typedef T ValueT;
+
+			constexpr LogBinning(double lowerExponent, double upperExponent, size_t bins) :
+				m_exponents(lowerExponent, upperExponent, bins) {}
+
+			constexpr size_t bins() const { return m_exponents.bins(); }
+
+			size_t slot(T value) const {
+				return value > 0 ? m_exponents.slot(log10(double(value))) : 0;
+			}
+
+			double lowerEdge(size_t bin) const { return pow(10.0, m_exponents.lowerEdge(bin)); }
+
+			std::string label(size_t bin) const {
+				std::stringstream labelSS; labelSS << lowerEdge(bin);
+				return labelSS.str();
+			}
+
+			bool operator==(const LogBinning& other) const { return m_exponents == other.m_exponents; }
+
+		private:
+			LinearBinning<double> m_exponents;
+	};
+
+	/**
+	 * Bins between ascending edges, [e0, e1), [e1, e2), ..., [en-1, en]
+	 *
+	 * The last bin includes its upper edge, so that e.g. an allele
+	 * frequency of 1 falls into the last bin of edges ending at 1. Equally
+	 * spaced edges are binned arithmetically; others by counting the edges
+	 * at or below the value, which has no data-dependent branches.
+	 */
+	template <typename T>
+	class EdgeBinning {
+		public:
+			typedef T ValueT;
+
+			EdgeBinning(const std::vector<T>& edges) : m_edges(edges) {
+				assert(m_edges.size() >= 2);
+
+				size_t n = bins();
+				m_uniform = true;
+				for(size_t i = 0; i <= n; i++) {
+					m_uniform = m_uniform && m_edges[i] == m_edges[0] + (m_edges[n] - m_edges[0]) * T(i) / T(n);
+				}
+			}
+
+			/**
+			 * @return Equally spaced edges from lower to upper
+			 */
+			static EdgeBinning uniform(T lower, T upper, size_t bins) {
+				std::vector<T> edges(bins + 1);
+				for(size_t i = 0; i <= bins; i++) edges[i] = lower + (upper - lower) * T(i) / T(bins);
+				return EdgeBinning(edges);
+			}
+
+			size_t bins() const { return m_edges.size() - 1; }
+
+			size_t slot(T value) const {
+				size_t n = bins();
+
+				if(m_uniform) {
+					if(!(value >= m_edges[0])) return 0;
+					if(value > m_edges[n]) return n + 1;
+					size_t bin = size_t((value - m_edges[0]) / (m_edges[n] - m_edges[0]) * T(n));
+					return bin < n ? bin + 1 : n;
+				}
+
+				size_t slot = 0;
+				for(size_t i = 0; i < n; i++) slot += (value >= m_edges[i]);
+				return slot + (value > m_edges[n]);
+			}
+
+			const std::vector<T>& edges() const { return m_edges; }
+
+			double lowerEdge(size_t bin) const { return double(m_edges[bin]); }
+
+			std::string label(size_t bin) const {
+				std::stringstream labelSS; labelSS << m_edges[bin];
+				return labelSS.str();
+			}
+
+			bool operator==(const EdgeBinning& other) const { return m_edges == other.m_edges; }
+
+		private:
+			std::vector<T> m_edges;
+			bool m_uniform;
+	};
+
+	/**
+	 * Log-linear bins of non-negative integers, as in HdrHistogram
+	 *
+	 * Values below 2^b are binned exactly; above, every power of two is
+	 * split into 2^(b-1) equal bins, so a bin is never wider than
+	 * 2^-(b-1) of its values. b follows from the relative precision asked
+	 * for, e.g. 1/32 gives b = 6 and exact bins up to 63. The bin of a
+	 * value is found from the position of its highest set bit, in constant
+	 * time, and the number of bins only grows with log2(maxValue); lengths
+	 * from 1 bp to megabases or depths from 0 to 10^5 need a few hundred.
+	 * Negative values are counted as underflow, and values from the power
+	 * of two above maxValue on as overflow.
+	 */
+	class HdrBinning {
+		public:
+			typedef int64_t ValueT;
+
+			/**
+			 * @param relativePrecision The largest bin width relative to its values, in (0, 1]
+			 * @param maxValue The largest value that is binned
+			 */
+			HdrBinning(double relativePrecision, int64_t maxValue) {
+				assert(relativePrecision > 0 && relativePrecision <= 1 && maxValue > 0);
+
+				m_bits = 1;
+				while(ldexp(1.0, -(m_bits - 1)) > relativePrecision) m_bits++;
+				m_exact = uint64_t(1) << m_bits;
+				m_half = m_exact >> 1;
+
+				m_maxExponent = 64 - __builtin_clzll(uint64_t(maxValue));
+				if(m_maxExponent < m_bits) m_maxExponent = m_bits;
+				m_bins = m_exact + size_t(m_maxExponent - m_bits) * m_half;
+			}
+
+			size_t bins() const { return m_bins; }
+
+			size_t slot(int64_t value) const {
+				if(value < 0) return 0;
+				uint64_t v = uint64_t(value);
+				if(v < m_exact) return size_t(v) + 1;
+
+				int exponent = 63 - __builtin_clzll(v);
+				if(exponent >= m_maxExponent) return m_bins + 1;
+				// the b significant bits of v, of which the first is set
+				uint64_t mantissa = v >> (exponent - m_bits + 1);
+				return 1 + m_exact + size_t(exponent - m_bits) * m_half + size_t(mantissa - m_half);
+			}
+
+			int64_t lowerEdge(size_t bin) const {
+				if(bin < m_exact) return int64_t(bin);
+				size_t octave = (bin - m_exact) / m_half;
+				uint64_t mantissa = m_half + (bin - m_exact) % m_half;
+				return int64_t(mantissa << (octave + 1));
+			}
+
+			/**
+			 * @return The smallest value of the overflow
+			 */
+			int64_t upperEdge() const { return int64_t(uint64_t(1) << m_maxExponent); }
+
+			std::string label(size_t bin) const {
+				std::stringstream labelSS; labelSS << lowerEdge(bin);
+				return labelSS.str();
+			}
+
+			bool operator==(const HdrBinning& other) const {
+				return m_bits == other.m_bits && m_maxExponent == other.m_maxExponent;
+			}
+
+		private:
+			int m_bits;				// b, the significant bits kept
+			int m_maxExponent;		// values are binned below 2^m_maxExponent
+			uint64_t m_exact;		// 2^b, the values binned exactly
+			uint64_t m_half;		// 2^(b-1), the bins per power of two above
+			size_t m_bins;
+	};
+
+	/**
+	 * One bin per index 0 .. bins - 1, e.g. per enum value
+	 */
+	class IndexBinning {
+		public:
+			typedef size_t ValueT;
+
+			constexpr IndexBinning(size_t bins) : m_bins(bins) {}
+
+			constexpr size_t bins() const { return m_bins; }
+
+			constexpr size_t slot(size_t index) const { return index < m_bins ? index + 1 : m_bins + 1; }
+
+			double lowerEdge(size_t bin) const { return double(bin); }
+
+			std::string label(size_t bin) const {
+				std::stringstream labelSS; labelSS << bin;
+				return labelSS.str();
+			}
+
+			bool operator==(const IndexBinning& other) const { return m_bins == other.m_bins; }
+
+		private:
+			size_t m_bins;
+	};
+
+	/**
+	 * A histogram with a fixed binning, and underflow and overflow counts
+	 *
+	 * Histograms of the same binning can be merged, e.g. the histograms
+	 * of two collectors that processed different shards.
+	 */
+	template <class BinningT, typename CountT = uint64_t>
+	class Histogram {
+		public:
+			typedef typename BinningT::ValueT ValueT;
+
+			Histogram(const BinningT& binning) :
+				m_binning(binning),
+				m_slots(binning.bins() + 2, 0) {}
+
+			void add(ValueT value, CountT count = 1) { m_slots[m_binning.slot(value)] += count; }
+
+			const BinningT& binning() const { return m_binning; }
+			size_t bins() const { return m_binning.bins(); }
+
+			CountT count(size_t bin) const { return m_slots[bin + 1]; }
+			CountT underflow() const { return m_slots[0]; }
+			CountT overflow() const { return m_slots[m_slots.size() - 1]; }
+
+			/**
+			 * @return The count of a slot, see the binnings above
+			 */
+			CountT slotCount(size_t slot) const { return m_slots[slot]; }
+			size_t slots() const { return m_slots.size(); }
+
+			/**
+			 * @return The number of values added, including under- and overflow
+			 */
+			uint64_t total() const {
+				uint64_t sum = 0;
+				for(size_t i = 0; i < m_slots.size(); i++) sum += m_slots[i];
+				return sum;
+			}
+
+			void merge(const Histogram& other) {
+				assert(m_binning == other.m_binning);
+				for(size_t i = 0; i < m_slots.size(); i++) m_slots[i] += other.m_slots[i];
+			}
+
+			/**
+			 * @return {"bins": {label: count}, "underflow": n, "overflow": n},
+			 *         listing the non-empty bins by their labels
+			 */
+			json_t* toJson() const {
+				json_t * j_hist = json_object();
+				json_t * j_bins = json_object();
+				for(size_t bin = 0; bin < bins(); bin++) {
+					if(count(bin) == 0) continue;
+					json_object_set_new(j_bins, m_binning.label(bin).c_str(), json_integer(count(bin)));
+				}
+				json_object_set_new(j_hist, "bins", j_bins);
+				json_object_set_new(j_hist, "underflow", json_integer(underflow()));
+				json_object_set_new(j_hist, "overflow", json_integer(overflow()));
+				return j_hist;
+			}
+
+		private:
+			BinningT m_binning;
+			std::vector<CountT> m_slots;
+	};
+}
+
+#endif
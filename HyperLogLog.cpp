@@ -0,0 +1,52 @@
+#include "HyperLogLog.h"
+
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace VcfStatsAlive;
+
+const size_t HyperLogLog::kRegisters;
+
+HyperLogLog::HyperLogLog() {
+	memset(_registers, 0, sizeof(_registers));
+}
+
+void HyperLogLog::merge(const HyperLogLog& other) {
+	size_t i = 0;
+
+#ifdef __SSE2__
+	for(; i + 16 <= kRegisters; i += 16) {
+		__m128i mine = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_registers + i));
+		__m128i theirs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(other._registers + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(_registers + i), _mm_max_epu8(mine, theirs));
+	}
+#endif
+
+	for(; i < kRegisters; i++) {
+		if(other._registers[i] > _registers[i]) _registers[i] = other._registers[i];
+	}
+}
+
+double HyperLogLog::estimate() const {
+	const double m = double(kRegisters);
+	const double alpha = 0.7213 / (1.0 + 1.079 / m);
+
+	double harmonicSum = 0;
+	size_t zeros = 0;
+	for(size_t i = 0; i < kRegisters; i++) {
+		harmonicSum += std::ldexp(1.0, -int(_registers[i]));
+		if(_registers[i] == 0) zeros++;
+	}
+
+	double estimate = alpha * m * m / harmonicSum;
+
+	// Small range correction: linear counting while many registers are empty
+	if(estimate <= 2.5 * m && zeros > 0) {
+		estimate = m * std::log(m / double(zeros));
+	}
+
+	return estimate;
+}
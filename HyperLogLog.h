@@ -0,0 +1,82 @@
+#ifndef HYPERLOGLOG_H
+#define HYPERLOGLOG_H
+
+#pragma once
+
+#include <stdint.h>
+#include <cstring>
+
+namespace VcfStatsAlive {
+
+	/**
+	 * 64-bit finalizer (murmur3 fmix64); spreads the bits of a key
+	 */
+	inline uint64_t hashMix(uint64_t key) {
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdULL;
+		key ^= key >> 33;
+		key *= 0xc4ceb9fe1a85ec53ULL;
+		key ^= key >> 33;
+		return key;
+	}
+
+	/**
+	 * Hash a byte string, chaining from a seed so that composite keys can
+	 * be hashed field by field without building the key in memory
+	 */
+	inline uint64_t hashBytes(const void* data, size_t length, uint64_t seed = 0) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		uint64_t hash = seed ^ (length * 0x9e3779b97f4a7c15ULL);
+
+		while(length >= 8) {
+			uint64_t word;
+			memcpy(&word, bytes, 8);
+			hash = hashMix(hash ^ word);
+			bytes += 8;
+			length -= 8;
+		}
+
+		uint64_t tail = 0;
+		for(size_t i = 0; i < length; i++) tail |= uint64_t(bytes[i]) << (8 * i);
+		return hashMix(hash ^ tail ^ 0x27d4eb2f165667c5ULL);
+	}
+
+	static const unsigned int kHllPrecision = 12;
+
+	/**
+	 * HyperLogLog distinct-count estimator
+	 *
+	 * Uses 2^kHllPrecision one-byte registers (4 KB), giving a standard
+	 * error of about 1.6%. Callers add 64-bit hashes of their keys. Merging
+	 * two estimators takes the register-wise maximum, which is done 16
+	 * registers at a time when SSE2 is available.
+	 */
+	class HyperLogLog {
+		public:
+			static const size_t kRegisters = size_t(1) << kHllPrecision;
+
+			HyperLogLog();
+
+			void add(uint64_t hash) {
+				size_t idx = hash >> (64 - kHllPrecision);
+				uint64_t rest = (hash << kHllPrecision) | (uint64_t(1) << (kHllPrecision - 1));
+				uint8_t rank = uint8_t(__builtin_clzll(rest) + 1);
+				if(rank > _registers[idx]) _registers[idx] = rank;
+			}
+
+			/**
+			 * Fold the registers of another estimator into this one
+			 */
+			void merge(const HyperLogLog& other);
+
+			/**
+			 * @return The estimated number of distinct hashes added
+			 */
+			double estimate() const;
+
+		private:
+			uint8_t _registers[kRegisters];
+	};
+}
+
+#endif
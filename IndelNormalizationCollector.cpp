@@ -0,0 +1,215 @@
+#include "IndelNormalizationCollector.h"
+#include "NucleotideTables.h"
+#include "VariantAlleles.h"
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+// Bound on the left shift of a single record, e.g. along a long repeat
+static const int kMaxNormalizationSteps = 100000;
+
+IndelNormalizationCollector::IndelNormalizationCollector(bcf_hdr_t* hdr, shared_ptr<ReferenceFasta> reference) :
+	AbstractStatCollector(),
+	m_window(reference) {
+
+	int contigCount = hdr->n[BCF_DT_CTG];
+	m_contigNames.resize(contigCount);
+	m_fastaContigs.resize(contigCount);
+	m_counts.resize(contigCount, NormCounts());
+
+	for(int rid = 0; rid < contigCount; rid++) {
+		m_contigNames[rid] = bcf_hdr_id2name(hdr, rid);
+		m_fastaContigs[rid] = reference->contigIndex(m_contigNames[rid].c_str());
+	}
+}
+
+IndelNormalizationCollector::~IndelNormalizationCollector() {
+}
+
+IndelNormalizationCollector::NormCounts& IndelNormalizationCollector::countsFor(size_t rid, const char* name) {
+	if(rid >= m_counts.size()) {
+		m_counts.resize(rid + 1, NormCounts());
+		m_contigNames.resize(rid + 1);
+		m_fastaContigs.resize(rid + 1, -1);
+	}
+
+	// Contigs added after construction are named when first counted
+	if(m_contigNames[rid].empty()) {
+		m_contigNames[rid] = name;
+		m_fastaContigs[rid] = m_window.reference().contigIndex(name);
+	}
+	return m_counts[rid];
+}
+
+void IndelNormalizationCollector::normalize(int contig, hts_pos_t& pos, int alleleCount) {
+	for(int step = 0; step < kMaxNormalizationSteps; step++) {
+		bool changed = false;
+
+		// Drop a common last base
+		bool sameLast = true;
+		for(int i = 0; i < alleleCount && sameLast; i++) {
+			sameLast = !m_work[i].empty() && m_work[i].back() == m_work[0].back();
+		}
+		if(sameLast) {
+			for(int i = 0; i < alleleCount; i++) m_work[i].pop_back();
+			changed = true;
+		}
+
+		// Extend to the left when an allele ran empty
+		bool anyEmpty = false;
+		for(int i = 0; i < alleleCount; i++) anyEmpty = anyEmpty || m_work[i].empty();
+		if(anyEmpty) {
+			const char* base = pos > 0 ? m_window.bases(contig, pos - 1, pos) : NULL;
+			if(base == NULL) return;
+
+			for(int i = 0; i < alleleCount; i++) m_work[i].insert(m_work[i].begin(), *base);
+			pos--;
+			changed = true;
+		}
+
+		if(!changed) break;
+	}
+
+	// Drop common first bases
+	while(true) {
+		bool trimmable = true;
+		for(int i = 0; i < alleleCount && trimmable; i++) {
+			trimmable = m_work[i].size() >= 2 && m_work[i][0] == m_work[0][0];
+		}
+		if(!trimmable) break;
+
+		for(int i = 0; i < alleleCount; i++) m_work[i].erase(0, 1);
+		pos++;
+	}
+}
+
+void IndelNormalizationCollector::processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) {
+	if(var->rid < 0) return;
+
+	const VariantAlleles& alleles = VariantAlleles::of(var);
+	int alleleCount = var->n_allele;
+	if(alleleCount < 2) return;
+
+	bool isIndel = false;
+	for(int i = 0; i < alleleCount; i++) {
+		if(alleles.isSymbolic(i) || alleles.firstBase(i) == '*') return;
+		isIndel = isIndel || alleles.length(i) != alleles.length(0);
+	}
+	if(!isIndel) return;
+
+	NormCounts& counts = countsFor(var->rid, bcf_hdr_id2name(hdr, var->rid));
+	counts.checked++;
+
+	int contig = m_fastaContigs[var->rid];
+	if(contig < 0) {
+		counts.noReference++;
+		return;
+	}
+
+	int refLength = alleles.length(0);
+	const char* refBases = m_window.bases(contig, var->pos, var->pos + refLength);
+	bool refMatches = (refBases != NULL);
+	for(int i = 0; i < refLength && refMatches; i++) {
+		refMatches = kUpperBase[uint8_t(var->d.allele[0][i])] == refBases[i];
+	}
+	if(!refMatches) {
+		counts.refMismatch++;
+		return;
+	}
+
+	// Records whose alleles do not all end with the same base, and do not
+	// all start with the same base unless one is a single base, are left
+	// unchanged by normalization
+	bool sameLast = true, sameFirst = true, anySingle = false;
+	char last = kUpperBase[uint8_t(var->d.allele[0][refLength - 1])];
+	char first = kUpperBase[uint8_t(alleles.firstBase(0))];
+	for(int i = 1; i < alleleCount; i++) {
+		sameLast = sameLast && kUpperBase[uint8_t(var->d.allele[i][alleles.length(i) - 1])] == last;
+		sameFirst = sameFirst && kUpperBase[uint8_t(alleles.firstBase(i))] == first;
+	}
+	for(int i = 0; i < alleleCount; i++) anySingle = anySingle || alleles.length(i) == 1;
+	if(!sameLast && (anySingle || !sameFirst)) return;
+
+	if(m_work.size() < size_t(alleleCount)) m_work.resize(alleleCount);
+	size_t originalLength = 0;
+	for(int i = 0; i < alleleCount; i++) {
+		m_work[i].clear();
+		for(const char* c = var->d.allele[i]; *c; c++) m_work[i].push_back(kUpperBase[uint8_t(*c)]);
+		originalLength += m_work[i].size();
+	}
+
+	hts_pos_t pos = var->pos;
+	normalize(contig, pos, alleleCount);
+
+	size_t normalizedLength = 0;
+	for(int i = 0; i < alleleCount; i++) normalizedLength += m_work[i].size();
+
+	if(pos < var->pos) counts.notLeftAligned++;
+	if(normalizedLength < originalLength) counts.notParsimonious++;
+}
+
+void IndelNormalizationCollector::mergeImpl(const AbstractStatCollector& otherCollector) {
+	const IndelNormalizationCollector& other = static_cast<const IndelNormalizationCollector&>(otherCollector);
+
+	// Contigs are matched by name, the other header may order them differently
+	map<string, size_t> ridByName;
+	for(size_t rid = 0; rid < m_contigNames.size(); rid++) ridByName[m_contigNames[rid]] = rid;
+
+	for(size_t otherRid = 0; otherRid < other.m_counts.size(); otherRid++) {
+		const NormCounts& otherCounts = other.m_counts[otherRid];
+		if(otherCounts.checked == 0) continue;
+
+		size_t rid;
+		map<string, size_t>::iterator loc = ridByName.find(other.m_contigNames[otherRid]);
+		if(loc != ridByName.end()) {
+			rid = loc->second;
+		}
+		else {
+			rid = m_counts.size();
+			countsFor(rid, other.m_contigNames[otherRid].c_str());
+			ridByName[m_contigNames[rid]] = rid;
+		}
+
+		NormCounts& counts = m_counts[rid];
+		counts.checked += otherCounts.checked;
+		counts.notLeftAligned += otherCounts.notLeftAligned;
+		counts.notParsimonious += otherCounts.notParsimonious;
+		counts.refMismatch += otherCounts.refMismatch;
+		counts.noReference += otherCounts.noReference;
+	}
+}
+
+static json_t* countsToJson(uint64_t checked, uint64_t notLeftAligned, uint64_t notParsimonious,
+		uint64_t refMismatch, uint64_t noReference) {
+	json_t * j_counts = json_object();
+	json_object_set_new(j_counts, "checked", json_integer(checked));
+	json_object_set_new(j_counts, "notLeftAligned", json_integer(notLeftAligned));
+	json_object_set_new(j_counts, "notParsimonious", json_integer(notParsimonious));
+	json_object_set_new(j_counts, "refMismatch", json_integer(refMismatch));
+	json_object_set_new(j_counts, "noReference", json_integer(noReference));
+	return j_counts;
+}
+
+void IndelNormalizationCollector::appendJsonImpl(json_t * jsonRootObj) {
+	NormCounts total = NormCounts();
+	json_t * j_contigs = json_object();
+
+	for(size_t rid = 0; rid < m_counts.size(); rid++) {
+		const NormCounts& counts = m_counts[rid];
+		if(counts.checked == 0) continue;
+
+		total.checked += counts.checked;
+		total.notLeftAligned += counts.notLeftAligned;
+		total.notParsimonious += counts.notParsimonious;
+		total.refMismatch += counts.refMismatch;
+		total.noReference += counts.noReference;
+
+		json_object_set_new(j_contigs, m_contigNames[rid].c_str(), countsToJson(counts.checked,
+				counts.notLeftAligned, counts.notParsimonious, counts.refMismatch, counts.noReference));
+	}
+
+	json_t * j_norm = countsToJson(total.checked, total.notLeftAligned, total.notParsimonious,
+			total.refMismatch, total.noReference);
+	json_object_set_new(j_norm, "contigs", j_contigs);
+	json_object_set_new(jsonRootObj, "indel_norm", j_norm);
+}
@@ -0,0 +1,66 @@
+#ifndef INDELNORMALIZATIONCOLLECTOR_H
+#define INDELNORMALIZATIONCOLLECTOR_H
+
+#pragma once
+
+#include "AbstractStatCollector.h"
+#include "ReferenceFasta.h"
+
+namespace VcfStatsAlive {
+
+	/**
+	 * Check that indels are left-aligned and parsimonious
+	 *
+	 * A record is normalized if the normalization algorithm of Tan et al.
+	 * (2015) leaves it unchanged: while all alleles end with the same base,
+	 * drop that base, extending all alleles one reference base to the left
+	 * whenever one becomes empty; then, while all alleles are at least two
+	 * bases long and start with the same base, drop that base. A record
+	 * that would move left is not left-aligned; one that would get shorter
+	 * is not parsimonious. Records with sequence alleles of differing
+	 * lengths are checked; symbolic and '*' alleles are skipped.
+	 *
+	 * Most records pass a check of their first and last bases, so only
+	 * violations walk the reference, through a cached window that follows
+	 * sorted input. Counts are kept per contig.
+	 */
+	class IndelNormalizationCollector : public AbstractStatCollector {
+
+		protected:
+			struct NormCounts {
+				uint64_t checked;
+				uint64_t notLeftAligned;
+				uint64_t notParsimonious;
+				uint64_t refMismatch;
+				uint64_t noReference;
+			};
+
+			ReferenceWindow m_window;
+
+			// indexed by rid of the header, which may grow while reading
+			std::vector<std::string> m_contigNames;
+			std::vector<int> m_fastaContigs;
+			std::vector<NormCounts> m_counts;
+
+			// reusable allele buffers of the normalization walk
+			std::vector<std::string> m_work;
+
+			virtual void processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) override;
+			virtual void appendJsonImpl(json_t * jsonRootObj) override;
+			virtual void mergeImpl(const AbstractStatCollector& other) override;
+
+		private:
+			NormCounts& countsFor(size_t rid, const char* name);
+			void normalize(int contig, hts_pos_t& pos, int alleleCount);
+
+		public:
+			/**
+			 * @param hdr The vcf header providing contig names
+			 * @param reference The reference the variants were called against
+			 */
+			IndelNormalizationCollector(bcf_hdr_t* hdr, std::shared_ptr<ReferenceFasta> reference);
+			virtual ~IndelNormalizationCollector();
+	};
+}
+
+#endif
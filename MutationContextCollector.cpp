@@ -0,0 +1,144 @@
+#include "MutationContextCollector.h"
+#include "NucleotideTables.h"
+#include "VariantAlleles.h"
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+static const char kAcgt[] = "ACGT";
+
+// Substitution number (0-5) by pyrimidine-strand ref and alt base index,
+// in COSMIC order C>A C>G C>T T>A T>C T>G; -1 where ref is not C or T
+static const int kSubstitutionChannel[4][4] = {
+	/* A */	{ -1, -1, -1, -1 },
+	/* C */	{ 0, -1, 1, 2 },
+	/* G */	{ -1, -1, -1, -1 },
+	/* T */	{ 3, 4, 5, -1 }
+};
+
+// Pyrimidine-strand alt base index by substitution number
+static const int kSubstitutionAlt[6] = { 0, 2, 3, 0, 1, 2 };
+
+MutationContextCollector::MutationContextCollector(shared_ptr<ReferenceFasta> reference) :
+	AbstractStatCollector(),
+	m_window(reference),
+	m_mappedHdr(NULL),
+	m_records(0),
+	m_refMismatches(0),
+	m_noContext(0) {
+
+	memset(m_channels, 0, sizeof(m_channels));
+}
+
+MutationContextCollector::~MutationContextCollector() {
+}
+
+int MutationContextCollector::contigIndex(const bcf_hdr_t* hdr, int rid) {
+	if(hdr != m_mappedHdr) {
+		m_mappedHdr = hdr;
+		m_contigIndexes.assign(hdr->n[BCF_DT_CTG], -2);
+	}
+
+	if(rid < 0 || rid >= hdr->n[BCF_DT_CTG]) return -1;
+
+	// The header gains contigs that are not declared as records name them
+	if(rid >= int(m_contigIndexes.size())) m_contigIndexes.resize(hdr->n[BCF_DT_CTG], -2);
+
+	int& index = m_contigIndexes[rid];
+	if(index == -2) index = m_window.reference().contigIndex(bcf_hdr_id2name(hdr, rid));
+	return index;
+}
+
+void MutationContextCollector::processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) {
+	m_records++;
+
+	const VariantAlleles& alleles = VariantAlleles::of(var);
+	if(alleles.length(0) != 1) return;
+
+	const char* context = NULL;
+	bool contextLoaded = false;
+
+	for(int altIndex = 1; altIndex < var->n_allele; altIndex++) {
+		if(alleles.length(altIndex) != 1) continue;
+
+		uint8_t ref = kAcgtIndex[uint8_t(alleles.firstBase(0))];
+		uint8_t alt = kAcgtIndex[uint8_t(alleles.firstBase(altIndex))];
+		if(ref > 3 || alt > 3 || ref == alt) continue;
+
+		// One window lookup per record, shared by its alternate alleles
+		if(!contextLoaded) {
+			context = m_window.bases(contigIndex(hdr, var->rid), var->pos - 1, var->pos + 2);
+			contextLoaded = true;
+		}
+
+		if(context == NULL) {
+			m_noContext++;
+			continue;
+		}
+
+		if(kAcgtIndex[uint8_t(context[1])] != ref) {
+			m_refMismatches++;
+			continue;
+		}
+
+		uint8_t five = kAcgtIndex[uint8_t(context[0])];
+		uint8_t three = kAcgtIndex[uint8_t(context[2])];
+		if(five > 3 || three > 3) {
+			m_noContext++;
+			continue;
+		}
+
+		// Purine refs are flipped onto the other strand: complement every
+		// base and swap the flanks. With A=0 C=1 G=2 T=3, the complement
+		// of an index is 3 - index.
+		if(ref == 0 || ref == 2) {
+			ref = 3 - ref;
+			alt = 3 - alt;
+			uint8_t flank = five;
+			five = 3 - three;
+			three = 3 - flank;
+		}
+
+		m_channels[kSubstitutionChannel[ref][alt] * 16 + five * 4 + three]++;
+	}
+}
+
+void MutationContextCollector::mergeImpl(const AbstractStatCollector& otherCollector) {
+	const MutationContextCollector& other = static_cast<const MutationContextCollector&>(otherCollector);
+
+	m_records += other.m_records;
+	for(size_t i = 0; i < kSbsChannels; i++) m_channels[i] += other.m_channels[i];
+	m_refMismatches += other.m_refMismatches;
+	m_noContext += other.m_noContext;
+}
+
+bool MutationContextCollector::isSatisfiedImpl() {
+	double total = 0;
+	for(size_t i = 0; i < kSbsChannels; i++) total += m_channels[i];
+
+	for(size_t i = 0; i < kSbsChannels; i++) {
+		if(!isProportionSettled(m_channels[i], total, m_records)) return false;
+	}
+
+	return true;
+}
+
+void MutationContextCollector::appendJsonImpl(json_t * jsonRootObj) {
+	json_t * j_sbs = json_object();
+	json_t * j_channels = json_object();
+
+	for(size_t channel = 0; channel < kSbsChannels; channel++) {
+		size_t substitution = channel / 16;
+		char label[8] = {
+			kAcgt[(channel / 4) % 4], '[',
+			substitution < 3 ? 'C' : 'T', '>', kAcgt[kSubstitutionAlt[substitution]], ']',
+			kAcgt[channel % 4], '\0'
+		};
+		json_object_set_new(j_channels, label, json_integer(m_channels[channel]));
+	}
+
+	json_object_set_new(j_sbs, "channels", j_channels);
+	json_object_set_new(j_sbs, "refMismatch", json_integer(m_refMismatches));
+	json_object_set_new(j_sbs, "noContext", json_integer(m_noContext));
+	json_object_set_new(jsonRootObj, "sbs96", j_sbs);
+}
@@ -0,0 +1,56 @@
+#ifndef MUTATIONCONTEXTCOLLECTOR_H
+#define MUTATIONCONTEXTCOLLECTOR_H
+
+#pragma once
+
+#include "AbstractStatCollector.h"
+#include "ReferenceFasta.h"
+
+namespace VcfStatsAlive {
+
+	// 6 pyrimidine substitutions x 4 5' bases x 4 3' bases
+	static const size_t kSbsChannels = 96;
+
+	/**
+	 * Collect the 96-channel single base substitution spectrum
+	 *
+	 * Every SNV allele is counted by its substitution and the reference
+	 * bases on either side, read from an indexed FASTA. Substitutions are
+	 * reported from the pyrimidine strand, so a G>T change in ACA is
+	 * counted as the C>A change in TGT. Channels follow the COSMIC order
+	 * and labels, e.g. A[C>A]G. SNVs whose REF does not match the FASTA,
+	 * on contigs the FASTA lacks, at contig ends or next to non-ACGT bases
+	 * are counted separately rather than in a channel.
+	 */
+	class MutationContextCollector : public AbstractStatCollector {
+
+		protected:
+			ReferenceWindow m_window;
+
+			// per-header cache of FASTA contig indexes, indexed by rid
+			const bcf_hdr_t* m_mappedHdr;
+			std::vector<int> m_contigIndexes;
+
+			uint64_t m_records;
+			uint64_t m_channels[kSbsChannels];
+			uint64_t m_refMismatches;
+			uint64_t m_noContext;
+
+			virtual void processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) override;
+			virtual void appendJsonImpl(json_t * jsonRootObj) override;
+			virtual void mergeImpl(const AbstractStatCollector& other) override;
+			virtual bool isSatisfiedImpl() override;
+
+		private:
+			int contigIndex(const bcf_hdr_t* hdr, int rid);
+
+		public:
+			/**
+			 * @param reference The reference the variants were called against
+			 */
+			MutationContextCollector(std::shared_ptr<ReferenceFasta> reference);
+			virtual ~MutationContextCollector();
+	};
+}
+
+#endif
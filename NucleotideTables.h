@@ -0,0 +1,98 @@
+#ifndef NUCLEOTIDETABLES_H
+#define NUCLEOTIDETABLES_H
+
+#pragma once
+
+#include <stdint.h>
+
+namespace VcfStatsAlive {
+
+	/*
+	 * Base codes, one byte per character:
+	 *   bits 0-2  mutation spectrum index, A=0 G=1 C=2 T=3, 4 for anything else
+	 *   bits 3-4  base kind, see BaseKindT
+	 */
+	typedef enum {
+		BK_PURINE = 0,
+		BK_PYRIMIDINE,
+		BK_OTHER,
+		BK_SIZE = 4
+	} BaseKindT;
+
+	// Index of the row and column that collect non-ACGT bases
+	static const uint8_t kInvalidBaseIdx = 4;
+
+	constexpr uint8_t baseCode(unsigned int c) {
+		return (c == 'A' || c == 'a') ? uint8_t(0 | (BK_PURINE << 3)) :
+			(c == 'G' || c == 'g') ? uint8_t(1 | (BK_PURINE << 3)) :
+			(c == 'C' || c == 'c') ? uint8_t(2 | (BK_PYRIMIDINE << 3)) :
+			(c == 'T' || c == 't') ? uint8_t(3 | (BK_PYRIMIDINE << 3)) :
+			uint8_t(kInvalidBaseIdx | (BK_OTHER << 3));
+	}
+
+	// Expand a constexpr function over all byte values
+#define VSA_BYTE_TABLE_4(f, i) f(i), f((i) + 1), f((i) + 2), f((i) + 3)
+#define VSA_BYTE_TABLE_16(f, i) VSA_BYTE_TABLE_4(f, i), VSA_BYTE_TABLE_4(f, (i) + 4), VSA_BYTE_TABLE_4(f, (i) + 8), VSA_BYTE_TABLE_4(f, (i) + 12)
+#define VSA_BYTE_TABLE_64(f, i) VSA_BYTE_TABLE_16(f, i), VSA_BYTE_TABLE_16(f, (i) + 16), VSA_BYTE_TABLE_16(f, (i) + 32), VSA_BYTE_TABLE_16(f, (i) + 48)
+#define VSA_BYTE_TABLE(f) { VSA_BYTE_TABLE_64(f, 0), VSA_BYTE_TABLE_64(f, 64), VSA_BYTE_TABLE_64(f, 128), VSA_BYTE_TABLE_64(f, 192) }
+
+	static constexpr uint8_t kBaseCodes[256] = VSA_BYTE_TABLE(baseCode);
+
+	inline uint8_t baseIdx(char base) { return kBaseCodes[uint8_t(base)] & 7; }
+	inline uint8_t baseKind(char base) { return kBaseCodes[uint8_t(base)] >> 3; }
+
+	/*
+	 * Bases in alphabetical order, A=0 C=1 G=2 T=3, and 4 for anything
+	 * else; the order of the COSMIC signature channels
+	 */
+	constexpr uint8_t acgtIndex(unsigned int c) {
+		return (c == 'A' || c == 'a') ? 0 : (c == 'C' || c == 'c') ? 1 :
+			(c == 'G' || c == 'g') ? 2 : (c == 'T' || c == 't') ? 3 : 4;
+	}
+
+	static constexpr uint8_t kAcgtIndex[256] = VSA_BYTE_TABLE(acgtIndex);
+
+	/*
+	 * Upper case complement of a base; anything but ACGT becomes N
+	 */
+	constexpr char complementBase(unsigned int c) {
+		return (c == 'A' || c == 'a') ? 'T' : (c == 'C' || c == 'c') ? 'G' :
+			(c == 'G' || c == 'g') ? 'C' : (c == 'T' || c == 't') ? 'A' : 'N';
+	}
+
+	static constexpr char kComplement[256] = VSA_BYTE_TABLE(complementBase);
+
+	/*
+	 * Upper case of a sequence character
+	 */
+	constexpr char upperBase(unsigned int c) {
+		return (c >= 'a' && c <= 'z') ? char(c - 'a' + 'A') : char(c);
+	}
+
+	static constexpr char kUpperBase[256] = VSA_BYTE_TABLE(upperBase);
+
+	typedef enum {
+		SC_TRANSITION = 0,
+		SC_TRANSVERSION,
+		SC_NONE
+	} SubstitutionClassT;
+
+	/*
+	 * Substitution class by (ref kind, alt kind). A purine changing into a
+	 * purine, or anything else into a pyrimidine, is a transition; a
+	 * purine into a pyrimidine, or anything else into a purine, a
+	 * transversion. Changes into a non-ACGT base are not counted.
+	 */
+	static constexpr uint8_t kSubstitutionClass[BK_SIZE * BK_SIZE] = {
+		/* ref purine */		SC_TRANSITION, SC_TRANSVERSION, SC_NONE, SC_NONE,
+		/* ref pyrimidine */	SC_TRANSVERSION, SC_TRANSITION, SC_NONE, SC_NONE,
+		/* ref other */			SC_TRANSVERSION, SC_TRANSITION, SC_NONE, SC_NONE,
+		/* unused */			SC_NONE, SC_NONE, SC_NONE, SC_NONE
+	};
+
+	inline uint8_t substitutionClass(char ref, char alt) {
+		return kSubstitutionClass[baseKind(ref) * BK_SIZE + baseKind(alt)];
+	}
+}
+
+#endif
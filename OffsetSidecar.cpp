@@ -0,0 +1,129 @@
+#include "OffsetSidecar.h"
+
+#include <htslib/bgzf.h>
+
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+static const char kSidecarMagic[8] = { 'V', 'S', 'A', 'I', 'D', 'X', '1', '\0' };
+
+// Compressed bytes between two checkpoints
+static const uint64_t kSidecarSpacing = 1024 * 1024;
+
+OffsetSidecar::OffsetSidecar() :
+	_fileSize(0),
+	_fileTime(0) {
+}
+
+string OffsetSidecar::pathFor(const string& filename) {
+	return filename + kSidecarSuffix;
+}
+
+bool OffsetSidecar::statDataFile(const string& filename, uint64_t& size, int64_t& mtime) const {
+	struct stat st;
+	if(stat(filename.c_str(), &st) != 0) return false;
+	size = uint64_t(st.st_size);
+	mtime = int64_t(st.st_mtime);
+	return true;
+}
+
+bool OffsetSidecar::load(const string& filename) {
+	uint64_t size;
+	int64_t mtime;
+	if(!statDataFile(filename, size, mtime)) return false;
+
+	ifstream in(pathFor(filename).c_str(), ios::binary);
+	if(!in) return false;
+
+	char magic[sizeof(kSidecarMagic)];
+	uint64_t storedSize, count;
+	int64_t storedTime;
+	in.read(magic, sizeof(magic));
+	in.read(reinterpret_cast<char*>(&storedSize), sizeof(storedSize));
+	in.read(reinterpret_cast<char*>(&storedTime), sizeof(storedTime));
+	in.read(reinterpret_cast<char*>(&count), sizeof(count));
+	if(!in || memcmp(magic, kSidecarMagic, sizeof(magic)) != 0) return false;
+
+	// A sidecar of an older version of the data file is useless
+	if(storedSize != size || storedTime != mtime) return false;
+
+	// The stored count must match the rest of the sidecar before it sizes
+	// anything; a truncated or corrupt sidecar counts as stale
+	streampos start = in.tellg();
+	in.seekg(0, ios::end);
+	uint64_t remaining = uint64_t(in.tellg() - start);
+	if(!in || count != remaining / sizeof(uint64_t) || remaining % sizeof(uint64_t) != 0) return false;
+	in.seekg(start);
+
+	vector<uint64_t> checkpoints(count);
+	if(count > 0) in.read(reinterpret_cast<char*>(&checkpoints[0]), count * sizeof(uint64_t));
+	if(!in) return false;
+
+	_checkpoints.swap(checkpoints);
+	_fileSize = size;
+	_fileTime = mtime;
+	return true;
+}
+
+bool OffsetSidecar::build(const string& filename) {
+	if(!statDataFile(filename, _fileSize, _fileTime)) return false;
+
+	htsFile* fp = hts_open(filename.c_str(), "r");
+	if(fp == NULL) return false;
+
+	const htsFormat* format = hts_get_format(fp);
+	bcf_hdr_t* hdr = format->compression == bgzf ? bcf_hdr_read(fp) : NULL;
+	if(hdr == NULL) {
+		hts_close(fp);
+		return false;
+	}
+
+	BGZF* bgzfp = fp->fp.bgzf;
+	bool isText = (format->format == vcf);
+
+	kstring_t line = { 0, 0, NULL };
+	bcf1_t* rec = isText ? NULL : bcf_init();
+
+	_checkpoints.clear();
+	uint64_t lastBlock = 0;
+	int ret;
+
+	while(true) {
+		uint64_t offset = bgzf_tell(bgzfp);
+		uint64_t block = offset >> 16;
+
+		// Text lines only need to be found, not parsed
+		ret = isText ? hts_getline(fp, KS_SEP_LINE, &line) : bcf_read(fp, hdr, rec);
+		if(ret < 0) break;
+
+		if(_checkpoints.empty() || block - lastBlock >= kSidecarSpacing) {
+			_checkpoints.push_back(offset);
+			lastBlock = block;
+		}
+	}
+
+	free(line.s);
+	if(rec != NULL) bcf_destroy(rec);
+	bcf_hdr_destroy(hdr);
+	hts_close(fp);
+
+	return ret == -1;
+}
+
+bool OffsetSidecar::save(const string& filename) const {
+	ofstream out(pathFor(filename).c_str(), ios::binary | ios::trunc);
+	if(!out) return false;
+
+	uint64_t count = _checkpoints.size();
+	out.write(kSidecarMagic, sizeof(kSidecarMagic));
+	out.write(reinterpret_cast<const char*>(&_fileSize), sizeof(_fileSize));
+	out.write(reinterpret_cast<const char*>(&_fileTime), sizeof(_fileTime));
+	out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+	if(count > 0) out.write(reinterpret_cast<const char*>(&_checkpoints[0]), count * sizeof(uint64_t));
+
+	return bool(out);
+}
@@ -0,0 +1,74 @@
+#ifndef OFFSETSIDECAR_H
+#define OFFSETSIDECAR_H
+
+#pragma once
+
+#include <stdint.h>
+
+namespace VcfStatsAlive {
+
+	static const char kSidecarSuffix[] = ".vsaidx";
+
+	/**
+	 * Record-start checkpoints of an unindexed BGZF vcf/bcf file
+	 *
+	 * A lightweight alternative to a tabix/csi index for sharding: a single
+	 * pass over the file notes the virtual offset of a record start roughly
+	 * every kSidecarSpacing bytes of compressed data (always at the first
+	 * record that begins in a new BGZF block). Text vcf lines are not
+	 * parsed during the pass. Readers can then seek to any checkpoint and
+	 * process the records up to the next one, which is enough to split the
+	 * file across threads. The checkpoints are saved next to the data file
+	 * and reused as long as its size and modification time are unchanged.
+	 */
+	class OffsetSidecar {
+		public:
+			OffsetSidecar();
+
+			/**
+			 * @return The path of the sidecar belonging to a data file
+			 */
+			static std::string pathFor(const std::string& filename);
+
+			/**
+			 * Load the sidecar of a data file, if it exists, is current and
+			 * holds as many checkpoints as its header says
+			 *
+			 * @return true if checkpoints were loaded
+			 */
+			bool load(const std::string& filename);
+
+			/**
+			 * Scan a BGZF-compressed data file and collect its checkpoints
+			 *
+			 * @return false if the file is not BGZF-compressed or cannot be read
+			 */
+			bool build(const std::string& filename);
+
+			/**
+			 * Write the checkpoints next to the data file
+			 *
+			 * @return false if the sidecar could not be written
+			 */
+			bool save(const std::string& filename) const;
+
+			/**
+			 * @return Virtual offsets of record starts, in file order
+			 */
+			const std::vector<uint64_t>& checkpoints() const { return _checkpoints; }
+
+			/**
+			 * @return The compressed size of the data file
+			 */
+			uint64_t fileSize() const { return _fileSize; }
+
+		private:
+			std::vector<uint64_t> _checkpoints;
+			uint64_t _fileSize;
+			int64_t _fileTime;
+
+			bool statDataFile(const std::string& filename, uint64_t& size, int64_t& mtime) const;
+	};
+}
+
+#endif
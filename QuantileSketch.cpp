@@ -0,0 +1,138 @@
+#include "QuantileSketch.h"
+
+#include <cmath>
+#include <limits>
+
+using namespace VcfStatsAlive;
+
+static const double kLevelCapacityDecay = 2.0 / 3.0;
+static const size_t kMinLevelCapacity = 2;
+
+QuantileSketch::QuantileSketch(unsigned int k) :
+	_k(k < kMinLevelCapacity ? kMinLevelCapacity : k),
+	_count(0),
+	_min(std::numeric_limits<double>::infinity()),
+	_max(-std::numeric_limits<double>::infinity()),
+	_retained(0),
+	_totalCapacity(0),
+	_coin(0x9e3779b9u) {
+
+	addLevels(1);
+	_levels[0].reserve(_k);
+}
+
+void QuantileSketch::addLevels(size_t levels) {
+	if(levels <= _levels.size()) return;
+	_levels.resize(levels);
+
+	// The top level gets the full k, each level below shrinks by 2/3
+	_capacities.resize(levels);
+	_totalCapacity = 0;
+	for(size_t h = 0; h < levels; h++) {
+		size_t depth = levels - 1 - h;
+		size_t cap = size_t(std::ceil(_k * std::pow(kLevelCapacityDecay, double(depth))));
+		_capacities[h] = cap < kMinLevelCapacity ? kMinLevelCapacity : cap;
+		_totalCapacity += _capacities[h];
+	}
+}
+
+void QuantileSketch::compact(size_t level) {
+	addLevels(level + 2);
+
+	std::vector<double>& items = _levels[level];
+	std::vector<double>& above = _levels[level + 1];
+
+	std::sort(items.begin(), items.end());
+
+	// An odd item out stays at this level
+	size_t first = items.size() % 2;
+
+	// Deterministic coin (xorshift) to pick odd or even positions
+	_coin ^= _coin << 13; _coin ^= _coin >> 17; _coin ^= _coin << 5;
+	size_t offset = _coin & 1;
+
+	for(size_t i = first + offset; i < items.size(); i += 2) {
+		above.push_back(items[i]);
+	}
+
+	size_t promoted = (items.size() - first) / 2;
+	items.resize(first);
+	_retained -= promoted;
+}
+
+void QuantileSketch::compress() {
+	while(_retained > _totalCapacity) {
+		for(size_t h = 0; h < _levels.size(); h++) {
+			if(_levels[h].size() >= _capacities[h]) {
+				compact(h);
+				break;
+			}
+		}
+	}
+}
+
+void QuantileSketch::add(double value) {
+	if(std::isnan(value)) return;
+
+	if(value < _min) _min = value;
+	if(value > _max) _max = value;
+	_count++;
+
+	_levels[0].push_back(value);
+	_retained++;
+
+	if(_retained > _totalCapacity) compress();
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+	if(other._count == 0) return;
+
+	addLevels(other._levels.size());
+
+	for(size_t h = 0; h < other._levels.size(); h++) {
+		_levels[h].insert(_levels[h].end(), other._levels[h].begin(), other._levels[h].end());
+	}
+
+	_retained += other._retained;
+	_count += other._count;
+	if(other._min < _min) _min = other._min;
+	if(other._max > _max) _max = other._max;
+
+	compress();
+}
+
+std::vector<double> QuantileSketch::quantiles(const std::vector<double>& fractions) const {
+	std::vector<double> result(fractions.size(), std::numeric_limits<double>::quiet_NaN());
+	if(_count == 0) return result;
+
+	std::vector<std::pair<double, uint64_t>> weighted;
+	weighted.reserve(_retained);
+	uint64_t totalWeight = 0;
+	for(size_t h = 0; h < _levels.size(); h++) {
+		uint64_t weight = uint64_t(1) << h;
+		for(size_t i = 0; i < _levels[h].size(); i++) {
+			weighted.push_back(std::make_pair(_levels[h][i], weight));
+		}
+		totalWeight += weight * _levels[h].size();
+	}
+	std::sort(weighted.begin(), weighted.end());
+
+	for(size_t q = 0; q < fractions.size(); q++) {
+		double fraction = fractions[q];
+		if(fraction <= 0) { result[q] = _min; continue; }
+		if(fraction >= 1) { result[q] = _max; continue; }
+
+		double target = fraction * double(totalWeight);
+		uint64_t cumulative = 0;
+		result[q] = _max;
+		for(size_t i = 0; i < weighted.size(); i++) {
+			cumulative += weighted[i].second;
+			if(double(cumulative) >= target) {
+				result[q] = weighted[i].first;
+				break;
+			}
+		}
+	}
+
+	return result;
+}
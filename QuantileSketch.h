@@ -0,0 +1,69 @@
+#ifndef QUANTILESKETCH_H
+#define QUANTILESKETCH_H
+
+#pragma once
+
+#include <stdint.h>
+
+namespace VcfStatsAlive {
+
+	static const unsigned int kDefaultSketchK = 200;
+
+	/**
+	 * A mergeable streaming quantile sketch (KLL)
+	 *
+	 * Values are kept in a stack of compactors. Level h holds items of
+	 * weight 2^h; when a level is full it is sorted and every other item is
+	 * promoted to the level above. The lower levels have geometrically
+	 * smaller capacities, so the memory footprint stays around 3k values
+	 * no matter how many values are added, and the rank error is roughly
+	 * 1.7/k. Two sketches can be merged level by level, which makes the
+	 * result independent of how the input was split.
+	 */
+	class QuantileSketch {
+		public:
+			QuantileSketch(unsigned int k = kDefaultSketchK);
+
+			/**
+			 * Add a single value to the sketch
+			 */
+			void add(double value);
+
+			/**
+			 * Fold another sketch into this one
+			 *
+			 * @param other The sketch to be merged; it is left unchanged
+			 */
+			void merge(const QuantileSketch& other);
+
+			/**
+			 * Estimate several quantiles in one pass over the retained items
+			 *
+			 * @param fractions The requested quantiles, each within [0, 1]
+			 * @return The estimated values, in the order requested
+			 */
+			std::vector<double> quantiles(const std::vector<double>& fractions) const;
+
+			uint64_t count() const { return _count; }
+			double min() const { return _min; }
+			double max() const { return _max; }
+
+		private:
+			unsigned int _k;
+			uint64_t _count;
+			double _min;
+			double _max;
+
+			size_t _retained;
+			size_t _totalCapacity;
+			uint32_t _coin;
+			std::vector<std::vector<double>> _levels;
+			std::vector<size_t> _capacities;
+
+			void addLevels(size_t levels);
+			void compact(size_t level);
+			void compress();
+	};
+}
+
+#endif
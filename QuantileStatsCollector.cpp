@@ -0,0 +1,89 @@
+#include "QuantileStatsCollector.h"
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+static const double kReportedQuantiles[] = { 0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99 };
+static const char* kReportedQuantileLabels[] = { "p1", "p5", "p25", "p50", "p75", "p95", "p99" };
+static const size_t kReportedQuantileCount = sizeof(kReportedQuantiles) / sizeof(kReportedQuantiles[0]);
+
+static json_t * sketchToJson(const QuantileSketch& sketch) {
+	json_t * j_sketch = json_object();
+	json_object_set_new(j_sketch, "count", json_integer(sketch.count()));
+	if(sketch.count() == 0) return j_sketch;
+
+	json_object_set_new(j_sketch, "min", json_real(sketch.min()));
+	json_object_set_new(j_sketch, "max", json_real(sketch.max()));
+
+	vector<double> fractions(kReportedQuantiles, kReportedQuantiles + kReportedQuantileCount);
+	vector<double> values = sketch.quantiles(fractions);
+	for(size_t i = 0; i < kReportedQuantileCount; i++) {
+		json_object_set_new(j_sketch, kReportedQuantileLabels[i], json_real(values[i]));
+	}
+
+	return j_sketch;
+}
+
+QuantileStatsCollector::QuantileStatsCollector(unsigned int sketchK) :
+	AbstractStatCollector(),
+	m_qualSketch(sketchK),
+	m_depthSketch(sketchK),
+	m_genotypeQualSketch(sketchK),
+	m_records(0),
+	m_depthBuf(NULL),
+	m_depthBufSize(0),
+	m_gqBuf(NULL),
+	m_gqBufSize(0) {
+}
+
+QuantileStatsCollector::~QuantileStatsCollector() {
+	free(m_depthBuf);
+	free(m_gqBuf);
+}
+
+void QuantileStatsCollector::processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) {
+	m_records++;
+
+	if(!bcf_float_is_missing(var->qual)) m_qualSketch.add(var->qual);
+
+	if(bcf_get_info_int32(hdr, var, "DP", &m_depthBuf, &m_depthBufSize) > 0 &&
+			m_depthBuf[0] != bcf_int32_missing) {
+		m_depthSketch.add(m_depthBuf[0]);
+	}
+
+	int count = bcf_get_format_int32(hdr, var, "GQ", &m_gqBuf, &m_gqBufSize);
+	for(int i = 0; i < count; i++) {
+		if(m_gqBuf[i] == bcf_int32_missing || m_gqBuf[i] == bcf_int32_vector_end) continue;
+		m_genotypeQualSketch.add(m_gqBuf[i]);
+	}
+}
+
+void QuantileStatsCollector::appendJsonImpl(json_t * jsonRootObj) {
+	json_t * j_quantiles = json_object();
+	json_object_set_new(j_quantiles, "QUAL", sketchToJson(m_qualSketch));
+	json_object_set_new(j_quantiles, "DP", sketchToJson(m_depthSketch));
+	json_object_set_new(j_quantiles, "GQ", sketchToJson(m_genotypeQualSketch));
+	json_object_set_new(jsonRootObj, "quantiles", j_quantiles);
+}
+
+void QuantileStatsCollector::mergeImpl(const AbstractStatCollector& otherCollector) {
+	const QuantileStatsCollector& other = static_cast<const QuantileStatsCollector&>(otherCollector);
+
+	m_qualSketch.merge(other.m_qualSketch);
+	m_depthSketch.merge(other.m_depthSketch);
+	m_genotypeQualSketch.merge(other.m_genotypeQualSketch);
+	m_records += other.m_records;
+}
+
+bool QuantileStatsCollector::isSatisfiedImpl() {
+
+	// The rank of a sample quantile p is off by z * sqrt(p (1 - p) / n),
+	// which is worst for the median; sketch error comes on top but is
+	// small next to that for the sample sizes involved
+	const QuantileSketch* sketches[] = { &m_qualSketch, &m_depthSketch, &m_genotypeQualSketch };
+	for(size_t i = 0; i < sizeof(sketches) / sizeof(sketches[0]); i++) {
+		if(!isProportionSettled(sketches[i]->count() / 2.0, sketches[i]->count(), m_records)) return false;
+	}
+
+	return true;
+}
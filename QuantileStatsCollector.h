@@ -0,0 +1,44 @@
+#ifndef QUANTILESTATSCOLLECTOR_H
+#define QUANTILESTATSCOLLECTOR_H
+
+#pragma once
+
+#include "AbstractStatCollector.h"
+#include "QuantileSketch.h"
+
+namespace VcfStatsAlive {
+
+	/**
+	 * Collect approximate quantiles of QUAL, INFO/DP and FORMAT/GQ
+	 *
+	 * Each value stream is summarized by a mergeable quantile sketch, so
+	 * memory stays bounded regardless of the number of records, and
+	 * collectors fed with different parts of the input can be merged into
+	 * the same result as a single streaming pass.
+	 */
+	class QuantileStatsCollector : public AbstractStatCollector {
+
+		protected:
+			QuantileSketch m_qualSketch;
+			QuantileSketch m_depthSketch;
+			QuantileSketch m_genotypeQualSketch;
+			size_t m_records;
+
+			// reusable htslib buffers
+			int32_t* m_depthBuf;
+			int m_depthBufSize;
+			int32_t* m_gqBuf;
+			int m_gqBufSize;
+
+			virtual void processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) override;
+			virtual void appendJsonImpl(json_t * jsonRootObj) override;
+			virtual void mergeImpl(const AbstractStatCollector& other) override;
+			virtual bool isSatisfiedImpl() override;
+
+		public:
+			QuantileStatsCollector(unsigned int sketchK = kDefaultSketchK);
+			virtual ~QuantileStatsCollector();
+	};
+}
+
+#endif
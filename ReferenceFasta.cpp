@@ -0,0 +1,141 @@
+#include "ReferenceFasta.h"
+#include "NucleotideTables.h"
+
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+ReferenceFasta::ReferenceFasta() :
+	m_data(NULL),
+	m_size(0) {
+}
+
+ReferenceFasta::~ReferenceFasta() {
+	if(m_data != NULL) munmap(const_cast<char*>(m_data), m_size);
+}
+
+shared_ptr<ReferenceFasta> ReferenceFasta::open(const string& filename) {
+	shared_ptr<ReferenceFasta> reference(new ReferenceFasta());
+
+	ifstream fai((filename + ".fai").c_str());
+	if(!fai) {
+		cerr<<"Unable to open fasta index "<<filename<<".fai"<<endl;
+		return shared_ptr<ReferenceFasta>();
+	}
+
+	string line;
+	while(getline(fai, line)) {
+		std::stringstream fields(line);
+		string name;
+		FaiEntry entry;
+		if(!getline(fields, name, '\t')) continue;
+		if(!(fields >> entry.length >> entry.offset >> entry.lineBases >> entry.lineWidth)) {
+			cerr<<"Invalid fasta index line: "<<line<<endl;
+			return shared_ptr<ReferenceFasta>();
+		}
+
+		reference->m_contigByName[name] = int(reference->m_contigs.size());
+		reference->m_contigs.push_back(entry);
+	}
+
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if(fd < 0) {
+		cerr<<"Unable to open fasta file "<<filename<<endl;
+		return shared_ptr<ReferenceFasta>();
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || st.st_size == 0) {
+		cerr<<"Unable to read fasta file "<<filename<<endl;
+		close(fd);
+		return shared_ptr<ReferenceFasta>();
+	}
+
+	void* data = mmap(NULL, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED) {
+		cerr<<"Unable to map fasta file "<<filename<<endl;
+		return shared_ptr<ReferenceFasta>();
+	}
+
+	reference->m_data = static_cast<const char*>(data);
+	reference->m_size = size_t(st.st_size);
+
+	if(reference->m_data[0] != '>') {
+		cerr<<"Fasta file "<<filename<<" is compressed or not a fasta file"<<endl;
+		return shared_ptr<ReferenceFasta>();
+	}
+
+	for(size_t i = 0; i < reference->m_contigs.size(); i++) {
+		const FaiEntry& entry = reference->m_contigs[i];
+		if(entry.lineBases <= 0 || entry.lineWidth < entry.lineBases) {
+			cerr<<"Invalid fasta index entry in "<<filename<<".fai"<<endl;
+			return shared_ptr<ReferenceFasta>();
+		}
+	}
+
+	return reference;
+}
+
+int ReferenceFasta::contigIndex(const char* name) const {
+	map<string, int>::const_iterator loc = m_contigByName.find(name);
+	return loc != m_contigByName.end() ? loc->second : -1;
+}
+
+hts_pos_t ReferenceFasta::read(int contig, hts_pos_t beg, hts_pos_t end, char* out) const {
+	const FaiEntry& entry = m_contigs[contig];
+	if(beg < 0) beg = 0;
+	if(end > entry.length) end = entry.length;
+
+	hts_pos_t copied = 0;
+	hts_pos_t pos = beg;
+	while(pos < end) {
+
+		// Copy up to the end of the current line
+		hts_pos_t column = pos % entry.lineBases;
+		hts_pos_t count = min(entry.lineBases - column, end - pos);
+		uint64_t offset = entry.offset + uint64_t(pos / entry.lineBases) * entry.lineWidth + column;
+		if(offset + count > m_size) break;
+
+		const char* src = m_data + offset;
+		for(hts_pos_t i = 0; i < count; i++) out[copied + i] = kUpperBase[uint8_t(src[i])];
+
+		copied += count;
+		pos += count;
+	}
+
+	return copied;
+}
+
+ReferenceWindow::ReferenceWindow(shared_ptr<ReferenceFasta> reference) :
+	m_reference(reference),
+	m_contig(-1),
+	m_beg(0),
+	m_end(0) {
+}
+
+const char* ReferenceWindow::bases(int contig, hts_pos_t beg, hts_pos_t end) {
+	if(contig < 0 || beg < 0 || end > m_reference->contigLength(contig) || beg >= end) return NULL;
+
+	if(contig != m_contig || beg < m_beg || end > m_end) {
+
+		// Keep a little of what comes before, for lookups that step back
+		hts_pos_t windowBeg = max(hts_pos_t(0), beg - kReferenceWindowSize / 8);
+		hts_pos_t windowEnd = min(m_reference->contigLength(contig), max(end, windowBeg + kReferenceWindowSize));
+
+		if(m_buffer.size() < size_t(windowEnd - windowBeg)) m_buffer.resize(size_t(windowEnd - windowBeg));
+		hts_pos_t copied = m_reference->read(contig, windowBeg, windowEnd, &m_buffer[0]);
+
+		m_contig = contig;
+		m_beg = windowBeg;
+		m_end = windowBeg + copied;
+		if(end > m_end) return NULL;
+	}
+
+	return &m_buffer[beg - m_beg];
+}
@@ -0,0 +1,98 @@
+#ifndef REFERENCEFASTA_H
+#define REFERENCEFASTA_H
+
+#pragma once
+
+#include <memory>
+
+namespace VcfStatsAlive {
+
+	// Bases decoded into a ReferenceWindow at a time
+	static const hts_pos_t kReferenceWindowSize = 64 * 1024;
+
+	/**
+	 * A memory-mapped, uncompressed FASTA file with a samtools .fai index
+	 *
+	 * The file is mapped read-only and never copied, so one instance can be
+	 * shared by any number of threads; each reader decodes the bases it
+	 * needs through its own ReferenceWindow.
+	 */
+	class ReferenceFasta {
+		public:
+			/**
+			 * Map a FASTA file and read its .fai index
+			 *
+			 * @param filename The FASTA file; the index is filename + ".fai"
+			 * @return The reference, or an empty pointer if either file
+			 *         cannot be read or the FASTA is compressed
+			 */
+			static std::shared_ptr<ReferenceFasta> open(const std::string& filename);
+
+			virtual ~ReferenceFasta();
+
+			/**
+			 * @return The index of a contig, or -1 if the FASTA lacks it
+			 */
+			int contigIndex(const char* name) const;
+
+			hts_pos_t contigLength(int contig) const { return m_contigs[contig].length; }
+
+			/**
+			 * Copy bases of a contig in upper case
+			 *
+			 * @param contig The index of the contig
+			 * @param beg The 0-based start, clipped to the contig
+			 * @param end The 0-based end (exclusive), clipped to the contig
+			 * @param out Receives end - beg bases after clipping
+			 * @return The number of bases copied
+			 */
+			hts_pos_t read(int contig, hts_pos_t beg, hts_pos_t end, char* out) const;
+
+		private:
+			struct FaiEntry {
+				hts_pos_t length;
+				uint64_t offset;		// of the first base
+				hts_pos_t lineBases;
+				hts_pos_t lineWidth;	// including the line break
+			};
+
+			const char* m_data;
+			size_t m_size;
+			std::vector<FaiEntry> m_contigs;
+			std::map<std::string, int> m_contigByName;
+
+			ReferenceFasta();
+	};
+
+	/**
+	 * A cached stretch of one reference contig
+	 *
+	 * Sorted input asks for positions that are close to the previous ones,
+	 * so bases are decoded (line breaks removed, upper-cased) a window at a
+	 * time and served from the cache until a position falls outside of it.
+	 */
+	class ReferenceWindow {
+		public:
+			ReferenceWindow(std::shared_ptr<ReferenceFasta> reference);
+
+			/**
+			 * @param contig The index of the contig
+			 * @param beg The 0-based start
+			 * @param end The 0-based end (exclusive)
+			 * @return The bases [beg, end), valid until the next call, or
+			 *         NULL if the range is not within the contig
+			 */
+			const char* bases(int contig, hts_pos_t beg, hts_pos_t end);
+
+			const ReferenceFasta& reference() const { return *m_reference; }
+
+		private:
+			std::shared_ptr<ReferenceFasta> m_reference;
+			std::vector<char> m_buffer;
+			int m_contig;
+			hts_pos_t m_beg;
+			hts_pos_t m_end;
+	};
+}
+
+#endif
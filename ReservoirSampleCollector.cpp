@@ -0,0 +1,198 @@
+#include "ReservoirSampleCollector.h"
+
+#include <cstdio>
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+// Category layout: variant types, insertion size buckets, deletion size
+// buckets, then the two quality overflow bins
+static const size_t kInsBucketOffset = VT_SIZE;
+static const size_t kDelBucketOffset = kInsBucketOffset + kIndelSizeBuckets;
+static const size_t kQualLowerCategory = kDelBucketOffset + kIndelSizeBuckets;
+static const size_t kQualUpperCategory = kQualLowerCategory + 1;
+static const size_t kCategoryCount = kQualUpperCategory + 1;
+
+static size_t indelSizeBucket(int refLength, int altLength) {
+	unsigned int size = refLength > altLength ? refLength - altLength : altLength - refLength;
+	size_t bucket = 31 - __builtin_clz(size);
+	return bucket < kIndelSizeBuckets ? bucket : kIndelSizeBuckets - 1;
+}
+
+static string indelSizeBucketLabel(size_t bucket) {
+	std::stringstream labelSS;
+	if(bucket == 0) labelSS << 1;
+	else if(bucket == kIndelSizeBuckets - 1) labelSS << ">=" << (1 << bucket);
+	else labelSS << (1 << bucket) << "-" << ((2 << bucket) - 1);
+	return labelSS.str();
+}
+
+ReservoirSampleCollector::ReservoirSampleCollector(int qualLower, int qualUpper, unsigned int reservoirSize) :
+	AbstractStatCollector(),
+	kQualHistLowerbound(qualLower),
+	kQualHistUpperbound(qualUpper),
+	m_reservoirSize(reservoirSize),
+	m_slots(kCategoryCount * reservoirSize * kExampleLength, '\0'),
+	m_seen(kCategoryCount, 0),
+	m_rngState(0x9E3779B97F4A7C15ULL) {
+}
+
+ReservoirSampleCollector::~ReservoirSampleCollector() {
+}
+
+uint64_t ReservoirSampleCollector::nextRandom() {
+	// xorshift64*
+	m_rngState ^= m_rngState >> 12;
+	m_rngState ^= m_rngState << 25;
+	m_rngState ^= m_rngState >> 27;
+	return m_rngState * 0x2545F4914F6CDD1DULL;
+}
+
+char* ReservoirSampleCollector::slot(size_t category, size_t index) {
+	return &m_slots[(category * m_reservoirSize + index) * kExampleLength];
+}
+
+const char* ReservoirSampleCollector::slot(size_t category, size_t index) const {
+	return &m_slots[(category * m_reservoirSize + index) * kExampleLength];
+}
+
+size_t ReservoirSampleCollector::filled(size_t category) const {
+	return m_seen[category] < m_reservoirSize ? size_t(m_seen[category]) : m_reservoirSize;
+}
+
+void ReservoirSampleCollector::offer(size_t category, bcf_hdr_t* hdr, bcf1_t* var, int altIndex) {
+	uint64_t seen = ++m_seen[category];
+
+	// Algorithm R: the n-th record replaces a random example with
+	// probability reservoirSize / n
+	size_t index;
+	if(seen <= m_reservoirSize) {
+		index = size_t(seen - 1);
+	}
+	else {
+		uint64_t draw = nextRandom() % seen;
+		if(draw >= m_reservoirSize) return;
+		index = size_t(draw);
+	}
+
+	char* dst = slot(category, index);
+	int written = snprintf(dst, kExampleLength, "%s:%lld:%s:", bcf_seqname(hdr, var), (long long)var->pos + 1, var->d.allele[0]);
+	size_t used = written < 0 ? 0 : min(size_t(written), kExampleLength - 1);
+
+	// A single alternate allele, or all of them for per-record categories
+	int firstAlt = altIndex > 0 ? altIndex : 1;
+	int lastAlt = altIndex > 0 ? altIndex : var->n_allele - 1;
+	for(int alt = firstAlt; alt <= lastAlt && used < kExampleLength - 1; alt++) {
+		written = snprintf(dst + used, kExampleLength - used, "%s%s", alt > firstAlt ? "," : "", var->d.allele[alt]);
+		used = written < 0 ? used : min(used + size_t(written), kExampleLength - 1);
+	}
+}
+
+void ReservoirSampleCollector::processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) {
+	const VariantAlleles& alleles = VariantAlleles::of(var);
+	int refLength = alleles.length(0);
+
+	for(int altIndex = 1; altIndex < var->n_allele; altIndex++) {
+		int altLength = alleles.length(altIndex);
+		VariantTypeT vt = BasicStatsCollector::classifyAllele(alleles, altIndex);
+
+		offer(vt, hdr, var, altIndex);
+
+		if(vt == VT_INS) offer(kInsBucketOffset + indelSizeBucket(refLength, altLength), hdr, var, altIndex);
+		else if(vt == VT_DEL) offer(kDelBucketOffset + indelSizeBucket(refLength, altLength), hdr, var, altIndex);
+	}
+
+	// Same overflow rules as the quality histogram, which reports a QUAL
+	// of exactly qualUpper + 1 in its lowerBin; a missing QUAL is below
+	// any bound
+	if(bcf_float_is_missing(var->qual) || int(var->qual) < kQualHistLowerbound ||
+			int(var->qual) == kQualHistUpperbound + 1)
+		offer(kQualLowerCategory, hdr, var, 0);
+	else if(int(var->qual) > kQualHistUpperbound + 1)
+		offer(kQualUpperCategory, hdr, var, 0);
+}
+
+void ReservoirSampleCollector::mergeImpl(const AbstractStatCollector& otherCollector) {
+	const ReservoirSampleCollector& other = static_cast<const ReservoirSampleCollector&>(otherCollector);
+	assert(m_reservoirSize == other.m_reservoirSize);
+
+	vector<char> merged(m_reservoirSize * kExampleLength);
+	vector<size_t> ours(m_reservoirSize), theirs(m_reservoirSize);
+
+	for(size_t category = 0; category < kCategoryCount; category++) {
+		if(other.m_seen[category] == 0) continue;
+
+		// Draw without replacement, taking each example from either side
+		// in proportion to the number of records it still stands for
+		uint64_t oursLeftSeen = m_seen[category], theirsLeftSeen = other.m_seen[category];
+		size_t oursLeft = filled(category), theirsLeft = other.filled(category);
+		for(size_t i = 0; i < oursLeft; i++) ours[i] = i;
+		for(size_t i = 0; i < theirsLeft; i++) theirs[i] = i;
+
+		size_t count = 0;
+		while(count < m_reservoirSize && (oursLeft > 0 || theirsLeft > 0)) {
+			bool fromOurs = theirsLeft == 0 ||
+				(oursLeft > 0 && nextRandom() % (oursLeftSeen + theirsLeftSeen) < oursLeftSeen);
+
+			const char* example;
+			if(fromOurs) {
+				size_t pick = size_t(nextRandom() % oursLeft);
+				example = slot(category, ours[pick]);
+				ours[pick] = ours[--oursLeft];
+				oursLeftSeen--;
+			}
+			else {
+				size_t pick = size_t(nextRandom() % theirsLeft);
+				example = other.slot(category, theirs[pick]);
+				theirs[pick] = theirs[--theirsLeft];
+				theirsLeftSeen--;
+			}
+
+			memcpy(&merged[count * kExampleLength], example, kExampleLength);
+			count++;
+		}
+
+		memcpy(slot(category, 0), &merged[0], count * kExampleLength);
+		m_seen[category] += other.m_seen[category];
+	}
+}
+
+json_t* ReservoirSampleCollector::reservoirToJson(size_t category) const {
+	json_t * j_examples = json_array();
+	for(size_t i = 0; i < filled(category); i++) {
+		json_array_append_new(j_examples, json_string(slot(category, i)));
+	}
+	return j_examples;
+}
+
+void ReservoirSampleCollector::appendJsonImpl(json_t * jsonRootObj) {
+	json_t * j_examples = json_object();
+
+	json_t * j_var_type = json_object();
+	for(size_t vt = 0; vt < VT_SIZE; vt++) {
+		if(m_seen[vt] == 0) continue;
+		json_object_set_new(j_var_type, BasicStatsCollector::variantTypeLabel(vt), reservoirToJson(vt));
+	}
+	json_object_set_new(j_examples, "var_type", j_var_type);
+
+	json_t * j_indel_size = json_object();
+	json_t * j_ins = json_object();
+	json_t * j_del = json_object();
+	for(size_t bucket = 0; bucket < kIndelSizeBuckets; bucket++) {
+		string label = indelSizeBucketLabel(bucket);
+		if(m_seen[kInsBucketOffset + bucket] > 0)
+			json_object_set_new(j_ins, label.c_str(), reservoirToJson(kInsBucketOffset + bucket));
+		if(m_seen[kDelBucketOffset + bucket] > 0)
+			json_object_set_new(j_del, label.c_str(), reservoirToJson(kDelBucketOffset + bucket));
+	}
+	json_object_set_new(j_indel_size, "INS", j_ins);
+	json_object_set_new(j_indel_size, "DEL", j_del);
+	json_object_set_new(j_examples, "indel_size", j_indel_size);
+
+	json_t * j_qual_dist = json_object();
+	json_object_set_new(j_qual_dist, "lowerBin", reservoirToJson(kQualLowerCategory));
+	json_object_set_new(j_qual_dist, "upperBin", reservoirToJson(kQualUpperCategory));
+	json_object_set_new(j_examples, "qual_dist", j_qual_dist);
+
+	json_object_set_new(jsonRootObj, "examples", j_examples);
+}
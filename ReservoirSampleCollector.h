@@ -0,0 +1,72 @@
+#ifndef RESERVOIRSAMPLECOLLECTOR_H
+#define RESERVOIRSAMPLECOLLECTOR_H
+
+#pragma once
+
+#include "AbstractStatCollector.h"
+#include "BasicStatsCollector.h"
+
+namespace VcfStatsAlive {
+
+	static const unsigned int kDefaultReservoirSize = 8;
+
+	// Example records are truncated to this many characters
+	static const size_t kExampleLength = 96;
+
+	// Indel sizes are bucketed by powers of two: 1, 2-3, ..., >=512
+	static const size_t kIndelSizeBuckets = 10;
+
+	/**
+	 * Keep example records of each variant category
+	 *
+	 * For every variant type, every power-of-two indel size bucket (for
+	 * insertions and deletions separately) and the lower and upper overflow
+	 * bins of the quality histogram, a uniform random sample of up to
+	 * reservoirSize records is kept as CHROM:POS:REF:ALT strings. The
+	 * categories match the ones counted by BasicStatsCollector, so an odd
+	 * count can be traced back to actual records without re-scanning the
+	 * file. Example strings are written into fixed-size slots allocated up
+	 * front, and only when a record is actually drawn into a reservoir, so
+	 * processing a record does not allocate.
+	 */
+	class ReservoirSampleCollector : public AbstractStatCollector {
+
+		protected:
+			const int kQualHistLowerbound;
+			const int kQualHistUpperbound;
+			const unsigned int m_reservoirSize;
+
+			// m_slots holds kExampleLength chars for each slot of each
+			// category; m_seen counts the records offered to a category
+			std::vector<char> m_slots;
+			std::vector<uint64_t> m_seen;
+
+			uint64_t m_rngState;
+
+			virtual void processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) override;
+			virtual void appendJsonImpl(json_t * jsonRootObj) override;
+			virtual void mergeImpl(const AbstractStatCollector& other) override;
+
+			// Examples are as good from a sample as from the whole input
+			virtual bool isSatisfiedImpl() override { return true; }
+
+		private:
+			uint64_t nextRandom();
+			char* slot(size_t category, size_t index);
+			const char* slot(size_t category, size_t index) const;
+			size_t filled(size_t category) const;
+			void offer(size_t category, bcf_hdr_t* hdr, bcf1_t* var, int altIndex);
+			json_t* reservoirToJson(size_t category) const;
+
+		public:
+			/**
+			 * @param qualLower The lower bound of the quality histogram
+			 * @param qualUpper The upper bound of the quality histogram
+			 * @param reservoirSize The number of examples kept per category
+			 */
+			ReservoirSampleCollector(int qualLower, int qualUpper, unsigned int reservoirSize = kDefaultReservoirSize);
+			virtual ~ReservoirSampleCollector();
+	};
+}
+
+#endif
@@ -20,8 +20,8 @@ namespace VcfStatsAlive {
                 ngt = bcf_get_genotypes(hdr, var, &gt_arr, &ngt_arr);
                 if (ngt <= 0) return; // no genotype info present
 
-                bool isSnp = bcf_is_snp(var);
-                int refLength = strlen(var->d.allele[0]);
+                const VariantAlleles& alleles = VariantAlleles::of(var);
+                bool isSnp = alleles.isSnp();
 
                 std::set<int> processedGenotypes;
 
@@ -35,11 +35,11 @@ namespace VcfStatsAlive {
                     if(processedGenotypes.find(gt) != processedGenotypes.end())
                         continue;
 
-                    int altLen = strlen(var->d.allele[gt]);
+                    int altLen = alleles.length(gt);
 
                     updateTsTvRatio(var, gt, isSnp);
                     updateMutationSpectrum(var, gt, isSnp);
-                    if(observedAltLen != altLen) updateVariantTypeDist(var, gt, refLength);
+                    if(observedAltLen != altLen) updateVariantTypeDist(alleles, gt);
                     
                     processedGenotypes.insert(gt);
                     observedAltLen = altLen;
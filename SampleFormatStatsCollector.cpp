@@ -0,0 +1,176 @@
+#include "SampleFormatStatsCollector.h"
+#include "Genotype.h"
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+SampleFormatStatsCollector::SampleFormatStatsCollector(bcf_hdr_t* hdr) :
+	AbstractStatCollector(),
+	m_dpBinning(kSampleDpPrecision, kSampleMaxDp),
+	m_dpStride(m_dpBinning.bins() + 2),
+	m_gt(NULL),
+	m_gtSize(0),
+	m_values(NULL),
+	m_valuesSize(0) {
+
+	size_t samples = bcf_hdr_nsamples(hdr);
+	m_sampleNames.resize(samples);
+	for(size_t i = 0; i < samples; i++) m_sampleNames[i] = hdr->samples[i];
+
+	m_dpHist.assign(samples * m_dpStride, 0);
+	m_gqHist.assign(samples * (kSampleGqBins + 1), 0);
+	m_abHist.assign(samples * (kSampleAbBins + 1), 0);
+}
+
+SampleFormatStatsCollector::~SampleFormatStatsCollector() {
+	free(m_gt);
+	free(m_values);
+}
+
+void SampleFormatStatsCollector::updateValueHist(bcf_hdr_t* hdr, bcf1_t* var, const char* tag,
+		vector<uint32_t>& hist, int bins) {
+
+	size_t samples = min(m_sampleNames.size(), size_t(bcf_hdr_nsamples(hdr)));
+	int n = bcf_get_format_int32(hdr, var, tag, &m_values, &m_valuesSize);
+	uint32_t* counts = hist.data();
+
+	if(n <= 0) {
+		for(size_t s = 0; s < samples; s++) counts[s * (bins + 1) + bins]++;
+		return;
+	}
+
+	int perSample = n / bcf_hdr_nsamples(hdr);
+	const int32_t* values = m_values;
+	for(size_t s = 0; s < samples; s++) {
+		int32_t value = values[s * perSample];
+		bool missing = (value == bcf_int32_missing) | (value == bcf_int32_vector_end);
+		int bin = min(max(value, 0), bins - 1);
+		bin = missing ? bins : bin;
+		counts[s * (bins + 1) + bin]++;
+	}
+}
+
+void SampleFormatStatsCollector::updateDepthHist(bcf_hdr_t* hdr, bcf1_t* var) {
+	size_t samples = min(m_sampleNames.size(), size_t(bcf_hdr_nsamples(hdr)));
+	int n = bcf_get_format_int32(hdr, var, "DP", &m_values, &m_valuesSize);
+	uint32_t* counts = m_dpHist.data();
+	size_t missingBin = m_dpStride - 1;
+
+	if(n <= 0) {
+		for(size_t s = 0; s < samples; s++) counts[s * m_dpStride + missingBin]++;
+		return;
+	}
+
+	// Slots of the binning are shifted down by one, negative depths are counted as 0
+	int perSample = n / bcf_hdr_nsamples(hdr);
+	const int32_t* values = m_values;
+	for(size_t s = 0; s < samples; s++) {
+		int32_t value = values[s * perSample];
+		bool missing = (value == bcf_int32_missing) | (value == bcf_int32_vector_end);
+		size_t bin = m_dpBinning.slot(max(value, 0)) - 1;
+		bin = missing ? missingBin : bin;
+		counts[s * m_dpStride + bin]++;
+	}
+}
+
+void SampleFormatStatsCollector::updateAlleleBalanceHist(bcf_hdr_t* hdr, bcf1_t* var) {
+	size_t samples = min(m_sampleNames.size(), size_t(bcf_hdr_nsamples(hdr)));
+	if(samples == 0) return;
+
+	int ngt = bcf_get_genotypes(hdr, var, &m_gt, &m_gtSize);
+	if(ngt <= 0) return;
+	int ploidy = ngt / bcf_hdr_nsamples(hdr);
+
+	int nad = bcf_get_format_int32(hdr, var, "AD", &m_values, &m_valuesSize);
+	int adPerSample = nad > 0 ? nad / bcf_hdr_nsamples(hdr) : 0;
+
+	uint32_t* counts = m_abHist.data();
+	for(size_t s = 0; s < samples; s++) {
+		const int32_t* gt = m_gt + s * ploidy;
+		if(genotypeClass(gt, ploidy) != GC_HET) continue;
+
+		// The first allele and the first one that differs from it
+		int a = bcf_gt_allele(gt[0]);
+		int b = a;
+		for(int i = 1; i < ploidy && b == a && gt[i] != bcf_int32_vector_end; i++) b = bcf_gt_allele(gt[i]);
+
+		int bin = kSampleAbBins;
+		if(a < adPerSample && b < adPerSample) {
+			int32_t adA = m_values[s * adPerSample + a];
+			int32_t adB = m_values[s * adPerSample + b];
+			if(adA >= 0 && adB >= 0 && adA + adB > 0) {
+				bin = int(int64_t(adB) * (kSampleAbBins - 1) / (adA + adB));
+			}
+		}
+		counts[s * (kSampleAbBins + 1) + bin]++;
+	}
+}
+
+void SampleFormatStatsCollector::processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) {
+	updateDepthHist(hdr, var);
+	updateValueHist(hdr, var, "GQ", m_gqHist, kSampleGqBins);
+	updateAlleleBalanceHist(hdr, var);
+}
+
+void SampleFormatStatsCollector::mergeImpl(const AbstractStatCollector& otherCollector) {
+	const SampleFormatStatsCollector& other = static_cast<const SampleFormatStatsCollector&>(otherCollector);
+
+	vector<size_t> sampleOfOther = matchSamples(m_sampleNames, other.m_sampleNames);
+	size_t samples = m_sampleNames.size();
+	m_dpHist.resize(samples * m_dpStride, 0);
+	m_gqHist.resize(samples * (kSampleGqBins + 1), 0);
+	m_abHist.resize(samples * (kSampleAbBins + 1), 0);
+
+	for(size_t otherSample = 0; otherSample < other.m_sampleNames.size(); otherSample++) {
+		size_t s = sampleOfOther[otherSample];
+
+		for(size_t i = 0; i < m_dpStride; i++)
+			m_dpHist[s * m_dpStride + i] += other.m_dpHist[otherSample * m_dpStride + i];
+		for(int i = 0; i <= kSampleGqBins; i++)
+			m_gqHist[s * (kSampleGqBins + 1) + i] += other.m_gqHist[otherSample * (kSampleGqBins + 1) + i];
+		for(int i = 0; i <= kSampleAbBins; i++)
+			m_abHist[s * (kSampleAbBins + 1) + i] += other.m_abHist[otherSample * (kSampleAbBins + 1) + i];
+	}
+}
+
+static json_t* histToJson(const uint32_t* counts, int bins, double binWidth) {
+	json_t * j_hist = json_object();
+	json_t * j_bins = json_object();
+	for(int i = 0; i < bins; i++) {
+		if(counts[i] == 0) continue;
+		std::stringstream labelSS; labelSS << i * binWidth;
+		json_object_set_new(j_bins, labelSS.str().c_str(), json_integer(counts[i]));
+	}
+	json_object_set_new(j_hist, "bins", j_bins);
+	json_object_set_new(j_hist, "missing", json_integer(counts[bins]));
+	return j_hist;
+}
+
+static json_t* depthHistToJson(const uint32_t* counts, const HdrBinning& binning) {
+	json_t * j_hist = json_object();
+	json_t * j_bins = json_object();
+	size_t bins = binning.bins();
+	for(size_t i = 0; i < bins; i++) {
+		if(counts[i] == 0) continue;
+		json_object_set_new(j_bins, binning.label(i).c_str(), json_integer(counts[i]));
+	}
+	json_object_set_new(j_hist, "bins", j_bins);
+	json_object_set_new(j_hist, "overflow", json_integer(counts[bins]));
+	json_object_set_new(j_hist, "missing", json_integer(counts[bins + 1]));
+	return j_hist;
+}
+
+void SampleFormatStatsCollector::appendJsonImpl(json_t * jsonRootObj) {
+	json_t * j_samples = json_object();
+
+	for(size_t s = 0; s < m_sampleNames.size(); s++) {
+		json_t * j_sample = json_object();
+		json_object_set_new(j_sample, "dp", depthHistToJson(&m_dpHist[s * m_dpStride], m_dpBinning));
+		json_object_set_new(j_sample, "gq", histToJson(&m_gqHist[s * (kSampleGqBins + 1)], kSampleGqBins, 1));
+		json_object_set_new(j_sample, "het_ab", histToJson(&m_abHist[s * (kSampleAbBins + 1)], kSampleAbBins,
+				1.0 / (kSampleAbBins - 1)));
+		json_object_set_new(j_samples, m_sampleNames[s].c_str(), j_sample);
+	}
+
+	json_object_set_new(jsonRootObj, "sample_format", j_samples);
+}
@@ -0,0 +1,75 @@
+#ifndef SAMPLEFORMATSTATSCOLLECTOR_H
+#define SAMPLEFORMATSTATSCOLLECTOR_H
+
+#pragma once
+
+#include "AbstractStatCollector.h"
+#include "Histogram.h"
+
+namespace VcfStatsAlive {
+
+	// DP exact up to 31, then in bins of at most 1/16 of their values
+	static const double kSampleDpPrecision = 1.0 / 16;
+	static const int kSampleMaxDp = 100000;
+	// GQ values at or above the last bin are counted in it
+	static const int kSampleGqBins = 100;
+	// Allele balance in steps of 0.05, the last bin holds a balance of 1
+	static const int kSampleAbBins = 21;
+
+	/**
+	 * Collect per-sample distributions of FORMAT/DP, FORMAT/GQ and the
+	 * allele balance of heterozygous calls
+	 *
+	 * Each FORMAT field is extracted once per record for all samples, into
+	 * buffers that are reused across records, and the histograms of all
+	 * samples are updated in one pass over that sample-major array. The
+	 * histograms of all samples live in one contiguous array per field,
+	 * with one extra bin per sample counting missing values, so that the
+	 * update loop has no branches besides the bin computation. DP, which
+	 * ranges from 0 to tens of thousands, is binned log-linearly, with an
+	 * overflow bin before the missing one.
+	 *
+	 * The allele balance of a heterozygous call a/b is AD[b] / (AD[a] +
+	 * AD[b]); calls without AD or with no reads for either allele are
+	 * counted as missing.
+	 */
+	class SampleFormatStatsCollector : public AbstractStatCollector {
+
+		protected:
+			std::vector<std::string> m_sampleNames;
+
+			HdrBinning m_dpBinning;
+			size_t m_dpStride;
+
+			// m_dpHist[sample * m_dpStride + bin], m_gqHist[sample * (kSampleGqBins + 1) + bin]
+			// and likewise
+			std::vector<uint32_t> m_dpHist;
+			std::vector<uint32_t> m_gqHist;
+			std::vector<uint32_t> m_abHist;
+
+			// reusable bcf_get_format_int32 buffers
+			int32_t* m_gt;
+			int m_gtSize;
+			int32_t* m_values;
+			int m_valuesSize;
+
+			virtual void processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) override;
+			virtual void appendJsonImpl(json_t * jsonRootObj) override;
+			virtual void mergeImpl(const AbstractStatCollector& other) override;
+
+		private:
+			void updateValueHist(bcf_hdr_t* hdr, bcf1_t* var, const char* tag,
+					std::vector<uint32_t>& hist, int bins);
+			void updateDepthHist(bcf_hdr_t* hdr, bcf1_t* var);
+			void updateAlleleBalanceHist(bcf_hdr_t* hdr, bcf1_t* var);
+
+		public:
+			/**
+			 * @param hdr The vcf header providing the samples
+			 */
+			SampleFormatStatsCollector(bcf_hdr_t* hdr);
+			virtual ~SampleFormatStatsCollector();
+	};
+}
+
+#endif
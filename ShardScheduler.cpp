@@ -0,0 +1,487 @@
+#include "ShardScheduler.h"
+
+#include <htslib/bgzf.h>
+
+#include <random>
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+// Shards spanning less compressed data than this are never split
+static const uint64_t kMinSplitCost = 256 * 1024;
+// Shards are split until there are about this many per worker
+static const uint64_t kShardsPerWorker = 4;
+// Genomic ranges shorter than this are never split
+static const hts_pos_t kMinShardSpan = 64 * 1024;
+
+ShardScheduler::ShardScheduler(const vector<string>& filenames, TreeFactoryT factory, size_t workers) :
+	_factory(factory),
+	_pool(workers),
+	_totalCost(0),
+	_splitCost(0),
+	_sampling(false),
+	_failed(false),
+	_pendingShards(filenames.size()),
+	_fileTrees(filenames.size(), NULL),
+	_treeHeaders(filenames.size(), NULL) {
+
+	_inputs.resize(filenames.size());
+	for(size_t i = 0; i < filenames.size(); i++) {
+		_inputs[i].filename = filenames[i];
+		_inputs[i].hdr = NULL;
+		_inputs[i].tbx = NULL;
+		_inputs[i].idx = NULL;
+	}
+
+	_readers.resize(filenames.size());
+	for(size_t i = 0; i < filenames.size(); i++) {
+		_readers[i].resize(_pool.workers());
+		for(size_t w = 0; w < _pool.workers(); w++) {
+			Reader& r = _readers[i][w];
+			r.fp = NULL;
+			r.hdr = NULL;
+			r.rec = NULL;
+			r.line.l = r.line.m = 0;
+			r.line.s = NULL;
+			r.tree = NULL;
+			r.sinceCheck = 0;
+			r.satisfied = false;
+		}
+	}
+}
+
+ShardScheduler::~ShardScheduler() {
+	for(size_t i = 0; i < _readers.size(); i++) {
+		for(size_t w = 0; w < _readers[i].size(); w++) {
+			Reader& r = _readers[i][w];
+			delete r.tree;
+			r.tree = NULL;
+			closeReader(r);
+		}
+	}
+
+	for(size_t i = 0; i < _inputs.size(); i++) {
+		delete _fileTrees[i];
+		if(_treeHeaders[i] != NULL) bcf_hdr_destroy(_treeHeaders[i]);
+		if(_inputs[i].hdr != NULL) bcf_hdr_destroy(_inputs[i].hdr);
+		if(_inputs[i].tbx != NULL) tbx_destroy(_inputs[i].tbx);
+		if(_inputs[i].idx != NULL) hts_idx_destroy(_inputs[i].idx);
+	}
+}
+
+bool ShardScheduler::open() {
+	for(size_t i = 0; i < _inputs.size(); i++) {
+		InputFile& input = _inputs[i];
+		const char* filename = input.filename.c_str();
+
+		htsFile* fp = hts_open(filename, "r");
+		if(fp == NULL) {
+			cerr<<"Unable to open vcf file "<<input.filename<<endl;
+			return false;
+		}
+
+		input.hdr = bcf_hdr_read(fp);
+		if(input.hdr == NULL) {
+			cerr<<"Unable to read vcf header of "<<input.filename<<endl;
+			hts_close(fp);
+			return false;
+		}
+
+		const htsFormat* format = hts_get_format(fp);
+		bool isBgzf = (format->compression == bgzf);
+		hts_close(fp);
+
+		if(format->format == bcf) {
+			input.idx = bcf_index_load(filename);
+		}
+		else if(format->format == vcf && isBgzf) {
+			input.tbx = tbx_index_load(filename);
+			if(input.tbx == NULL) {
+				string csiFilename = input.filename + ".csi";
+				input.tbx = tbx_index_load2(filename, csiFilename.c_str());
+			}
+		}
+
+		if(input.tbx != NULL || input.idx != NULL || !isBgzf) continue;
+
+		// Without an index, use the offset sidecar. Building one costs a
+		// pass over the file, which only pays off when workers would
+		// otherwise be left without a file to process.
+		if(input.sidecar.load(input.filename)) continue;
+		if(_inputs.size() >= _pool.workers()) continue;
+
+		cerr<<"No index found for "<<input.filename<<"; recording record offsets"<<endl;
+		if(!input.sidecar.build(input.filename)) {
+			input.sidecar = OffsetSidecar();
+			continue;
+		}
+		if(!input.sidecar.save(input.filename)) {
+			cerr<<"Unable to write "<<OffsetSidecar::pathFor(input.filename)<<endl;
+		}
+	}
+
+	return true;
+}
+
+ShardScheduler::Reader& ShardScheduler::reader(size_t file, size_t worker) {
+	Reader& r = _readers[file][worker];
+	if(r.fp != NULL) return r;
+
+	r.fp = hts_open(_inputs[file].filename.c_str(), "r");
+	if(r.fp != NULL) r.hdr = bcf_hdr_read(r.fp);
+	if(r.hdr == NULL) {
+		cerr<<"Unable to open vcf file "<<_inputs[file].filename<<endl;
+		_failed = true;
+		return r;
+	}
+
+	r.rec = bcf_init();
+	r.tree = _factory(r.hdr);
+	return r;
+}
+
+void ShardScheduler::closeReader(Reader& r) {
+	if(r.rec != NULL) bcf_destroy(r.rec);
+	if(r.hdr != NULL) bcf_hdr_destroy(r.hdr);
+	if(r.fp != NULL) hts_close(r.fp);
+	free(r.line.s);
+
+	r.fp = NULL;
+	r.hdr = NULL;
+	r.rec = NULL;
+	r.line.l = r.line.m = 0;
+	r.line.s = NULL;
+}
+
+void ShardScheduler::finishShard(size_t file) {
+	// Each worker's last decrement publishes its reader and tree to the
+	// worker that brings the count to zero
+	if(--_pendingShards[file] == 0) mergeFile(file);
+}
+
+void ShardScheduler::mergeFile(size_t file) {
+	AbstractStatCollector* merged = NULL;
+
+	for(size_t w = 0; w < _readers[file].size(); w++) {
+		Reader& r = _readers[file][w];
+		if(r.tree != NULL) {
+			if(merged == NULL) {
+				// The tree's factories may create collectors from its header
+				merged = r.tree;
+				_treeHeaders[file] = r.hdr;
+				r.hdr = NULL;
+			}
+			else {
+				merged->merge(*r.tree);
+				delete r.tree;
+			}
+			r.tree = NULL;
+		}
+
+		closeReader(r);
+	}
+
+	_fileTrees[file] = merged;
+}
+
+hts_itr_t* ShardScheduler::query(const VcfShard& shard) const {
+	const InputFile& input = _inputs[shard.file];
+	if(input.tbx != NULL) return tbx_itr_queryi(input.tbx, shard.tid, shard.beg, shard.end);
+	return bcf_itr_queryi(input.idx, shard.tid, shard.beg, shard.end);
+}
+
+uint64_t ShardScheduler::shardCost(const VcfShard& shard) const {
+	if(shard.kind == SHARD_OFFSETS) {
+		const InputFile& input = _inputs[shard.file];
+		const vector<uint64_t>& checkpoints = input.sidecar.checkpoints();
+		uint64_t end = shard.lastCheckpoint < checkpoints.size() ?
+			(checkpoints[shard.lastCheckpoint] >> 16) : input.sidecar.fileSize();
+		return end - (checkpoints[shard.firstCheckpoint] >> 16) + 1;
+	}
+
+	hts_itr_t* itr = query(shard);
+	if(itr == NULL) return 0;
+
+	// Compressed bytes spanned by the index chunks of the range
+	uint64_t cost = 0;
+	for(int i = 0; i < itr->n_off; i++) {
+		cost += ((itr->off[i].v >> 16) - (itr->off[i].u >> 16)) + 1;
+	}
+
+	hts_itr_destroy(itr);
+	return cost;
+}
+
+uint64_t ShardScheduler::initialShards(size_t file, vector<VcfShard>& shards) {
+	InputFile& input = _inputs[file];
+	uint64_t totalCost = 0;
+
+	VcfShard shard;
+	shard.file = file;
+	shard.kind = SHARD_WHOLE_FILE;
+	shard.tid = -1;
+	shard.beg = 0;
+	shard.end = HTS_POS_MAX;
+	shard.splitEnd = 0;
+	shard.firstCheckpoint = 0;
+	shard.lastCheckpoint = input.sidecar.checkpoints().size();
+
+	if(shard.lastCheckpoint > 0) {
+		shard.kind = SHARD_OFFSETS;
+		shards.push_back(shard);
+		return shardCost(shard);
+	}
+
+	if(input.tbx == NULL && input.idx == NULL) {
+		shards.push_back(shard);
+		return 0;
+	}
+
+	// One initial shard per indexed contig
+	shard.kind = SHARD_REGION;
+	int contigCount = 0;
+	const char** names = input.tbx != NULL ?
+		tbx_seqnames(input.tbx, &contigCount) :
+		bcf_index_seqnames(input.idx, input.hdr, &contigCount);
+
+	for(int c = 0; c < contigCount; c++) {
+		int rid = bcf_hdr_name2id(input.hdr, names[c]);
+
+		// tabix numbers contigs in index order, bcf indexes use header ids
+		shard.tid = input.tbx != NULL ? c : rid;
+		shard.splitEnd = rid >= 0 ? hts_pos_t(input.hdr->id[BCF_DT_CTG][rid].val->info[0]) : 0;
+
+		uint64_t cost = shardCost(shard);
+		if(cost == 0) continue;
+
+		totalCost += cost;
+		shards.push_back(shard);
+	}
+
+	free(names);
+	return totalCost;
+}
+
+bool ShardScheduler::run() {
+	vector<VcfShard> shards;
+	for(size_t i = 0; i < _inputs.size(); i++) _totalCost += initialShards(i, shards);
+	for(size_t i = 0; i < shards.size(); i++) _pendingShards[shards[i].file]++;
+
+	_splitCost = _totalCost / (_pool.workers() * kShardsPerWorker);
+	if(_splitCost < kMinSplitCost) _splitCost = kMinSplitCost;
+
+	for(size_t i = 0; i < shards.size(); i++) {
+		VcfShard shard = shards[i];
+		_pool.submit([this, shard](size_t worker) { processShard(worker, shard); });
+	}
+
+	_pool.run();
+
+	return !_failed;
+}
+
+bool ShardScheduler::runSampled(uint64_t seed) {
+	_sampling = true;
+
+	for(size_t i = 0; i < _inputs.size(); i++) {
+		_pendingShards[i] = 1;
+		_pool.submit([this, i, seed](size_t worker) {
+			sampleFile(worker, i, seed + i);
+			finishShard(i);
+		});
+	}
+
+	_pool.run();
+
+	return !_failed;
+}
+
+void ShardScheduler::sampleFile(size_t worker, size_t file, uint64_t seed) {
+	vector<VcfShard> shards;
+	initialShards(file, shards);
+
+	// Cut the file into small pieces: fixed spans of the contigs, or the
+	// stretches between two checkpoints
+	vector<VcfShard> pieces;
+	for(size_t i = 0; i < shards.size(); i++) {
+		VcfShard shard = shards[i];
+
+		if(shard.kind == SHARD_REGION && shard.splitEnd > kMinShardSpan) {
+			for(hts_pos_t beg = 0; beg < shard.splitEnd; beg += kMinShardSpan) {
+				VcfShard piece = shard;
+				piece.beg = beg;
+				piece.end = beg + kMinShardSpan < shard.splitEnd ? beg + kMinShardSpan : HTS_POS_MAX;
+				piece.splitEnd = piece.end;
+				pieces.push_back(piece);
+			}
+		}
+		else if(shard.kind == SHARD_OFFSETS) {
+			for(size_t c = shard.firstCheckpoint; c < shard.lastCheckpoint; c++) {
+				VcfShard piece = shard;
+				piece.firstCheckpoint = c;
+				piece.lastCheckpoint = c + 1;
+				pieces.push_back(piece);
+			}
+		}
+		else {
+			pieces.push_back(shard);
+		}
+	}
+
+	if(shards.size() == 1 && shards[0].kind == SHARD_WHOLE_FILE) {
+		cerr<<"No index or offset sidecar for "<<_inputs[file].filename<<"; sampling from its start"<<endl;
+	}
+
+	std::mt19937_64 rng(seed);
+	std::shuffle(pieces.begin(), pieces.end(), rng);
+
+	Reader& r = reader(file, worker);
+	if(r.hdr == NULL) return;
+
+	for(size_t i = 0; i < pieces.size() && !r.satisfied; i++) {
+		readShard(r, pieces[i]);
+	}
+}
+
+bool ShardScheduler::splitShard(size_t worker, VcfShard& shard) {
+	if(shard.kind == SHARD_REGION && shard.splitEnd - shard.beg <= kMinShardSpan) return false;
+	if(shard.kind == SHARD_OFFSETS && shard.lastCheckpoint - shard.firstCheckpoint < 2) return false;
+	if(shard.kind == SHARD_WHOLE_FILE) return false;
+
+	uint64_t cost = shardCost(shard);
+	if(cost <= _splitCost && !(cost > kMinSplitCost && _pool.hasIdleWorkers())) return false;
+
+	VcfShard upper = shard;
+	if(shard.kind == SHARD_REGION) {
+		hts_pos_t mid = shard.beg + (shard.splitEnd - shard.beg) / 2;
+		upper.beg = mid;
+		shard.end = mid;
+		shard.splitEnd = mid;
+	}
+	else {
+		size_t mid = shard.firstCheckpoint + (shard.lastCheckpoint - shard.firstCheckpoint) / 2;
+		upper.firstCheckpoint = mid;
+		shard.lastCheckpoint = mid;
+	}
+
+	_pendingShards[shard.file]++;
+	_pool.spawn(worker, [this, upper](size_t w) { processShard(w, upper); });
+	return true;
+}
+
+void ShardScheduler::processShard(size_t worker, VcfShard shard) {
+
+	// Split off the upper half while the shard is large, or while other
+	// workers have nothing to do; the half stays on this worker's queue
+	// until someone steals it
+	while(splitShard(worker, shard));
+
+	Reader& r = reader(shard.file, worker);
+	if(r.hdr != NULL) readShard(r, shard);
+
+	finishShard(shard.file);
+}
+
+void ShardScheduler::readShard(Reader& r, const VcfShard& shard) {
+	switch(shard.kind) {
+		case SHARD_REGION:
+			processRegion(r, shard);
+			break;
+		case SHARD_OFFSETS:
+			processOffsets(r, shard);
+			break;
+		default:
+			processWholeFile(r, shard);
+			break;
+	}
+}
+
+bool ShardScheduler::processRecord(Reader& r) {
+	if (bcf_unpack(r.rec, BCF_UN_STR) != 0) {
+		cerr<<"Error unpacking"<<endl;
+	}
+	r.tree->processVariant(r.hdr, r.rec);
+
+	if(!_sampling || ++r.sinceCheck < kSatisfiedCheckInterval) return true;
+
+	r.sinceCheck = 0;
+	r.satisfied = r.tree->isSatisfied();
+	return !r.satisfied;
+}
+
+void ShardScheduler::processRegion(Reader& r, const VcfShard& shard) {
+	hts_itr_t* itr = query(shard);
+	if(itr == NULL) return;
+
+	const InputFile& input = _inputs[shard.file];
+	int ret;
+	while(true) {
+		if(input.tbx != NULL) {
+			ret = tbx_itr_next(r.fp, input.tbx, itr, &r.line);
+			if(ret < 0) break;
+			if(vcf_parse(&r.line, r.hdr, r.rec) != 0) {
+				cerr<<"Error parsing vcf record in "<<input.filename<<endl;
+				continue;
+			}
+		}
+		else {
+			ret = bcf_itr_next(r.fp, itr, r.rec);
+			if(ret < 0) break;
+		}
+
+		// Records overlapping the start of the range belong to the shard before
+		if(r.rec->pos < shard.beg || r.rec->pos >= shard.end) continue;
+
+		if(!processRecord(r)) break;
+	}
+
+	if(ret < -1) {
+		cerr<<"Error reading vcf record in "<<input.filename<<endl;
+		_failed = true;
+	}
+
+	hts_itr_destroy(itr);
+}
+
+void ShardScheduler::processOffsets(Reader& r, const VcfShard& shard) {
+	const InputFile& input = _inputs[shard.file];
+	const vector<uint64_t>& checkpoints = input.sidecar.checkpoints();
+	BGZF* bgzfp = r.fp->fp.bgzf;
+
+	if(bgzf_seek(bgzfp, checkpoints[shard.firstCheckpoint], SEEK_SET) < 0) {
+		cerr<<"Unable to seek in "<<input.filename<<endl;
+		_failed = true;
+		return;
+	}
+
+	bool toEnd = (shard.lastCheckpoint >= checkpoints.size());
+	uint64_t end = toEnd ? 0 : checkpoints[shard.lastCheckpoint];
+
+	int ret = 0;
+	while((toEnd || uint64_t(bgzf_tell(bgzfp)) < end) && (ret = bcf_read(r.fp, r.hdr, r.rec)) == 0) {
+		if(!processRecord(r)) break;
+	}
+
+	if(ret < -1) {
+		cerr<<"Error reading vcf record in "<<input.filename<<endl;
+		_failed = true;
+	}
+}
+
+void ShardScheduler::processWholeFile(Reader& r, const VcfShard& shard) {
+	int ret;
+	while((ret = bcf_read(r.fp, r.hdr, r.rec)) == 0) {
+		if(!processRecord(r)) break;
+	}
+
+	if(ret < -1) {
+		cerr<<"Error reading vcf record in "<<_inputs[shard.file].filename<<endl;
+		_failed = true;
+	}
+}
+
+AbstractStatCollector* ShardScheduler::takeFileTree(size_t file) {
+	AbstractStatCollector* merged = _fileTrees[file];
+	_fileTrees[file] = NULL;
+	return merged;
+}
@@ -0,0 +1,182 @@
+#ifndef SHARDSCHEDULER_H
+#define SHARDSCHEDULER_H
+
+#pragma once
+
+#include "AbstractStatCollector.h"
+#include "WorkStealingPool.h"
+#include "OffsetSidecar.h"
+
+#include <htslib/tbx.h>
+
+namespace VcfStatsAlive {
+
+	typedef enum {
+		SHARD_WHOLE_FILE = 0,
+		SHARD_REGION,
+		SHARD_OFFSETS
+	} ShardKindT;
+
+	/**
+	 * A contiguous piece of one input file
+	 *
+	 * Files with a tabix or csi index are sharded by genomic range on one
+	 * contig; a shard counts the records that start within [beg, end).
+	 * BGZF files with an offset sidecar are sharded by checkpoint: a shard
+	 * covers the records from checkpoint firstCheckpoint up to (excluding)
+	 * checkpoint lastCheckpoint. Other files form a single shard covering
+	 * the whole stream.
+	 */
+	struct VcfShard {
+		size_t file;
+		ShardKindT kind;
+
+		// SHARD_REGION
+		int tid;				// contig id in the index
+		hts_pos_t beg;
+		hts_pos_t end;
+		hts_pos_t splitEnd;		// end of the contig as far as splitting is concerned
+
+		// SHARD_OFFSETS
+		size_t firstCheckpoint;
+		size_t lastCheckpoint;
+	};
+
+	/**
+	 * Process a set of vcf/bcf files in parallel on a work-stealing pool
+	 *
+	 * Indexed inputs start as one shard per indexed contig. The cost of a
+	 * shard is the amount of compressed data its index chunks span, taken
+	 * from the virtual offsets the index returns for its range. Unindexed
+	 * BGZF inputs are sharded by the checkpoints of an offset sidecar,
+	 * which is built on the fly when there are fewer inputs than workers,
+	 * and their cost is the compressed data between checkpoints. When a
+	 * worker picks up a shard that is large compared to the total, or while
+	 * other workers sit idle, it splits the range in half and leaves the
+	 * second half on its queue for others to steal. Wall time thus tracks
+	 * total work divided by the number of workers even when contigs differ
+	 * in size by orders of magnitude.
+	 *
+	 * Each worker keeps one reader and one collector tree per file, so
+	 * records are never handed between threads. The shards still pending
+	 * are counted per file; the worker that finishes the last shard of a
+	 * file merges its trees and closes its readers, so open files and
+	 * trees are bounded by the files in progress, not by all inputs.
+	 */
+	class ShardScheduler {
+		public:
+			using TreeFactoryT = std::function<AbstractStatCollector*(bcf_hdr_t*)>;
+
+			/**
+			 * @param filenames The input files
+			 * @param factory Builds a collector tree for a file header
+			 * @param workers The number of worker threads; 0 uses one per core
+			 */
+			ShardScheduler(const std::vector<std::string>& filenames, TreeFactoryT factory, size_t workers = 0);
+			virtual ~ShardScheduler();
+
+			/**
+			 * Read the headers and indexes of all inputs
+			 *
+			 * A tabix index is preferred for vcf.gz, falling back to a csi
+			 * index (needed for contigs over 512 Mb), then to an offset sidecar.
+			 *
+			 * @return false if any input could not be opened
+			 */
+			bool open();
+
+			/**
+			 * Process all shards of all inputs
+			 *
+			 * @return false if a read error occurred
+			 */
+			bool run();
+
+			/**
+			 * Process randomly chosen pieces of each input until its tree
+			 * is satisfied (see AbstractStatCollector::isSatisfied())
+			 *
+			 * Indexed inputs are cut into fixed spans of their contigs and
+			 * inputs with an offset sidecar into the stretches between
+			 * checkpoints; the pieces are read in a random order, so every
+			 * record is equally likely to be part of the sample. Other
+			 * inputs are read from the start. Inputs are sampled
+			 * concurrently, one per worker.
+			 *
+			 * @param seed Seed of the piece order, for repeatable reports
+			 * @return false if a read error occurred
+			 */
+			bool runSampled(uint64_t seed = 0);
+
+			/**
+			 * Take the tree a file's per-worker trees were merged into
+			 *
+			 * @param file The index of the file in the input list
+			 * @return The merged tree, owned by the caller, or NULL if the
+			 *         file produced no records. The header it was built from
+			 *         remains owned by the scheduler.
+			 */
+			AbstractStatCollector* takeFileTree(size_t file);
+
+			/**
+			 * @return The header of a file, valid for the scheduler's lifetime
+			 */
+			bcf_hdr_t* header(size_t file) const { return _inputs[file].hdr; }
+
+		private:
+			struct InputFile {
+				std::string filename;
+				bcf_hdr_t* hdr;
+				tbx_t* tbx;			// vcf.gz index
+				hts_idx_t* idx;		// bcf index
+				OffsetSidecar sidecar;
+			};
+
+			// A worker's private view of one input file
+			struct Reader {
+				htsFile* fp;
+				bcf_hdr_t* hdr;
+				bcf1_t* rec;
+				kstring_t line;
+				AbstractStatCollector* tree;
+				size_t sinceCheck;		// records since the last isSatisfied()
+				bool satisfied;
+			};
+
+			std::vector<InputFile> _inputs;
+			TreeFactoryT _factory;
+			WorkStealingPool _pool;
+
+			// _readers[file][worker]
+			std::vector<std::vector<Reader>> _readers;
+
+			// by file: shards queued or running, and once none are left the
+			// merged tree and the one reader header it was built from
+			std::vector<std::atomic<size_t>> _pendingShards;
+			std::vector<AbstractStatCollector*> _fileTrees;
+			std::vector<bcf_hdr_t*> _treeHeaders;
+
+			uint64_t _totalCost;
+			uint64_t _splitCost;
+			bool _sampling;
+			std::atomic<bool> _failed;
+
+			Reader& reader(size_t file, size_t worker);
+			void closeReader(Reader& r);
+			void finishShard(size_t file);
+			void mergeFile(size_t file);
+			hts_itr_t* query(const VcfShard& shard) const;
+			uint64_t shardCost(const VcfShard& shard) const;
+			uint64_t initialShards(size_t file, std::vector<VcfShard>& shards);
+			bool splitShard(size_t worker, VcfShard& shard);
+			void processShard(size_t worker, VcfShard shard);
+			void sampleFile(size_t worker, size_t file, uint64_t seed);
+			void readShard(Reader& r, const VcfShard& shard);
+			bool processRecord(Reader& r);
+			void processRegion(Reader& r, const VcfShard& shard);
+			void processOffsets(Reader& r, const VcfShard& shard);
+			void processWholeFile(Reader& r, const VcfShard& shard);
+	};
+}
+
+#endif
@@ -0,0 +1,242 @@
+#include "StratificationSpec.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+StratificationSpec::StratificationSpec() :
+	m_kind(SK_FLAG) {
+}
+
+static string edgeLabel(double edge) {
+	std::stringstream labelSS; labelSS << edge;
+	return labelSS.str();
+}
+
+shared_ptr<const StratificationSpec> StratificationSpec::parse(const string& spec) {
+	shared_ptr<StratificationSpec> parsed(new StratificationSpec());
+	parsed->m_text = spec;
+
+	if(spec.compare(0, 4, "bed:") == 0) {
+		parsed->m_kind = SK_BED;
+		if(!parsed->readBed(spec.substr(4))) return shared_ptr<const StratificationSpec>();
+		parsed->m_labels.push_back("in");
+		parsed->m_labels.push_back("out");
+		return parsed;
+	}
+
+	size_t separator = spec.find_first_of(":=");
+	parsed->m_tag = spec.substr(0, separator);
+	if(parsed->m_tag.empty()) {
+		cerr<<"Missing INFO tag in stratification "<<spec<<endl;
+		return shared_ptr<const StratificationSpec>();
+	}
+
+	if(separator == string::npos) {
+		parsed->m_kind = SK_FLAG;
+		parsed->m_labels.push_back("set");
+		parsed->m_labels.push_back("unset");
+		return parsed;
+	}
+
+	stringstream values(spec.substr(separator + 1));
+	string value;
+
+	if(spec[separator] == ':') {
+		parsed->m_kind = SK_NUMERIC;
+		while(getline(values, value, ',')) {
+			char* end;
+			double edge = strtod(value.c_str(), &end);
+			if(value.empty() || *end != 0 || (!parsed->m_edges.empty() && edge <= parsed->m_edges.back())) {
+				cerr<<"Invalid stratification edges "<<spec<<", expecting ascending numbers"<<endl;
+				return shared_ptr<const StratificationSpec>();
+			}
+			parsed->m_edges.push_back(edge);
+		}
+		if(parsed->m_edges.empty()) {
+			cerr<<"Missing stratification edges in "<<spec<<endl;
+			return shared_ptr<const StratificationSpec>();
+		}
+
+		const vector<double>& edges = parsed->m_edges;
+		parsed->m_labels.push_back("<" + edgeLabel(edges[0]));
+		for(size_t i = 1; i < edges.size(); i++) {
+			parsed->m_labels.push_back("[" + edgeLabel(edges[i - 1]) + "," + edgeLabel(edges[i]) + ")");
+		}
+		parsed->m_labels.push_back(">=" + edgeLabel(edges.back()));
+	}
+	else {
+		parsed->m_kind = SK_STRING;
+		while(getline(values, value, ',')) {
+			if(value.empty()) {
+				cerr<<"Empty stratification value in "<<spec<<endl;
+				return shared_ptr<const StratificationSpec>();
+			}
+			parsed->m_matches.push_back(value);
+		}
+		if(parsed->m_matches.empty()) {
+			cerr<<"Missing stratification values in "<<spec<<endl;
+			return shared_ptr<const StratificationSpec>();
+		}
+
+		parsed->m_labels = parsed->m_matches;
+		parsed->m_labels.push_back("other");
+	}
+
+	parsed->m_labels.push_back("missing");
+	return parsed;
+}
+
+bool StratificationSpec::readBed(const string& filename) {
+	ifstream bed(filename.c_str());
+	if(!bed) {
+		cerr<<"Unable to open BED file "<<filename<<endl;
+		return false;
+	}
+
+	map<string, vector<pair<hts_pos_t, hts_pos_t> > > intervals;
+	string line;
+	while(getline(bed, line)) {
+		if(line.empty() || line[0] == '#' || line.compare(0, 5, "track") == 0 || line.compare(0, 7, "browser") == 0) continue;
+
+		std::stringstream fields(line);
+		string contig;
+		hts_pos_t start, end;
+		if(!(fields >> contig >> start >> end) || start < 0 || end < start) {
+			cerr<<"Invalid BED line: "<<line<<endl;
+			return false;
+		}
+		intervals[contig].push_back(make_pair(start, end));
+	}
+
+	// Sort and merge overlapping intervals, so that a position is inside
+	// if the last interval starting at or before it ends after it
+	for(map<string, vector<pair<hts_pos_t, hts_pos_t> > >::iterator it = intervals.begin(); it != intervals.end(); it++) {
+		vector<pair<hts_pos_t, hts_pos_t> >& contigIntervals = it->second;
+		sort(contigIntervals.begin(), contigIntervals.end());
+
+		IntervalsT& merged = m_intervals[it->first];
+		for(size_t i = 0; i < contigIntervals.size(); i++) {
+			if(!merged.ends.empty() && contigIntervals[i].first <= merged.ends.back()) {
+				merged.ends.back() = max(merged.ends.back(), contigIntervals[i].second);
+				continue;
+			}
+			merged.starts.push_back(contigIntervals[i].first);
+			merged.ends.push_back(contigIntervals[i].second);
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @return The INFO value of the record, unpacked if need be, or NULL
+ */
+static const bcf_info_t* infoField(bcf1_t* var, int id) {
+	bcf_unpack(var, BCF_UN_INFO);
+	return bcf_get_info_id(var, id);
+}
+
+/**
+ * @return false if the record lacks the INFO value, or its first value is missing
+ */
+static bool infoNumber(bcf1_t* var, int id, double& value) {
+	const bcf_info_t* info = infoField(var, id);
+	if(info == NULL || info->len <= 0) return false;
+
+	// vptr points to the raw little endian values, which need not be aligned
+	switch(info->type) {
+		case BCF_BT_INT8: {
+			int8_t v = int8_t(info->vptr[0]);
+			value = v;
+			return v != bcf_int8_missing && v != bcf_int8_vector_end;
+		}
+		case BCF_BT_INT16: {
+			int16_t v; memcpy(&v, info->vptr, sizeof(v));
+			value = v;
+			return v != bcf_int16_missing && v != bcf_int16_vector_end;
+		}
+		case BCF_BT_INT32: {
+			int32_t v; memcpy(&v, info->vptr, sizeof(v));
+			value = v;
+			return v != bcf_int32_missing && v != bcf_int32_vector_end;
+		}
+		case BCF_BT_FLOAT: {
+			float v; memcpy(&v, info->vptr, sizeof(v));
+			value = v;
+			return !bcf_float_is_missing(v) && !bcf_float_is_vector_end(v) && !std::isnan(v);
+		}
+		case BCF_BT_CHAR: {
+			// e.g. an AF annotated as a String, up to the first ','
+			char text[64];
+			size_t length = min(size_t(info->len), sizeof(text) - 1);
+			memcpy(text, info->vptr, length);
+			text[length] = 0;
+			char* end;
+			value = strtod(text, &end);
+			return end != text && !std::isnan(value);
+		}
+		default:
+			return false;
+	}
+}
+
+BucketFunctionT StratificationSpec::compile(bcf_hdr_t* hdr) const {
+	size_t missing = m_labels.size() - 1;
+
+	if(m_kind == SK_BED) {
+		// Intervals by the contig ids of this header; the spec outlives the function
+		shared_ptr<vector<const IntervalsT*> > byRid(new vector<const IntervalsT*>(hdr->n[BCF_DT_CTG], NULL));
+		for(map<string, IntervalsT>::const_iterator it = m_intervals.begin(); it != m_intervals.end(); it++) {
+			int rid = bcf_hdr_name2id(hdr, it->first.c_str());
+			if(rid >= 0 && rid < int(byRid->size())) (*byRid)[rid] = &it->second;
+		}
+
+		return [byRid](bcf1_t* var) -> size_t {
+			if(var->rid < 0 || var->rid >= int(byRid->size()) || (*byRid)[var->rid] == NULL) return 1;
+
+			const IntervalsT& intervals = *(*byRid)[var->rid];
+			size_t next = upper_bound(intervals.starts.begin(), intervals.starts.end(), var->pos) - intervals.starts.begin();
+			return next > 0 && var->pos < intervals.ends[next - 1] ? 0 : 1;
+		};
+	}
+
+	int id = bcf_hdr_id2int(hdr, BCF_DT_ID, m_tag.c_str());
+	if(!bcf_hdr_idinfo_exists(hdr, BCF_HL_INFO, id)) {
+		return [missing](bcf1_t*) -> size_t { return missing; };
+	}
+
+	switch(m_kind) {
+		case SK_NUMERIC: {
+			vector<double> edges = m_edges;
+			return [id, edges, missing](bcf1_t* var) -> size_t {
+				double value;
+				if(!infoNumber(var, id, value)) return missing;
+
+				size_t bucket = 0;
+				for(size_t i = 0; i < edges.size(); i++) bucket += (value >= edges[i]);
+				return bucket;
+			};
+		}
+		case SK_STRING: {
+			vector<string> matches = m_matches;
+			return [id, matches, missing](bcf1_t* var) -> size_t {
+				const bcf_info_t* info = infoField(var, id);
+				if(info == NULL || info->len <= 0) return missing;
+				if(info->type != BCF_BT_CHAR) return missing - 1;
+
+				const char* text = (const char*) info->vptr;
+				const char* textEnd = text + info->len;
+				for(size_t i = 0; i < matches.size(); i++) {
+					if(search(text, textEnd, matches[i].begin(), matches[i].end()) != textEnd) return i;
+				}
+				return missing - 1;
+			};
+		}
+		default:
+			return [id](bcf1_t* var) -> size_t { return infoField(var, id) != NULL ? 0 : 1; };
+	}
+}
@@ -0,0 +1,83 @@
+#ifndef STRATIFICATIONSPEC_H
+#define STRATIFICATIONSPEC_H
+
+#pragma once
+
+#include <functional>
+#include <memory>
+
+namespace VcfStatsAlive {
+
+	/**
+	 * Maps a record to the index of its bucket, see StratificationSpec::compile()
+	 */
+	using BucketFunctionT = std::function<size_t(bcf1_t*)>;
+
+	/**
+	 * A rule that splits records into numbered buckets, given as one of
+	 *   TAG:e1,e2,...  numeric INFO/TAG, below e1, [e1, e2), ..., at or above the last edge
+	 *   TAG=a,b,...    string INFO/TAG, the first of a, b, ... the value contains, else other
+	 *   TAG            flag INFO/TAG, set or unset
+	 *   bed:FILE       POS inside or outside the intervals of a BED file
+	 * The INFO rules have a last bucket for records without the tag, and
+	 * use the first value of multi-valued tags.
+	 *
+	 * A spec is parsed once, reading the BED file if any, and shared by
+	 * every collector tree. Each tree compiles it against the header of
+	 * its input into a function that holds the INFO id or the intervals
+	 * by contig id of that header, so evaluating it per record costs a
+	 * scan of the unpacked INFO fields or a binary search, without tag or
+	 * contig name lookups.
+	 */
+	class StratificationSpec {
+		public:
+			/**
+			 * @param spec The rule, see above
+			 * @return The parsed spec, or an empty pointer if it is invalid
+			 *         or the BED file cannot be read
+			 */
+			static std::shared_ptr<const StratificationSpec> parse(const std::string& spec);
+
+			const std::string& text() const { return m_text; }
+
+			size_t buckets() const { return m_labels.size(); }
+			const std::string& label(size_t bucket) const { return m_labels[bucket]; }
+
+			/**
+			 * Bind the spec to the INFO and contig ids of a header. An INFO
+			 * tag the header does not declare puts every record in the last
+			 * bucket; a numeric rule on a String tag parses the value.
+			 *
+			 * @param hdr The vcf header of the records to classify
+			 * @return A function giving the bucket of a record
+			 */
+			BucketFunctionT compile(bcf_hdr_t* hdr) const;
+
+		private:
+			typedef enum {
+				SK_NUMERIC,
+				SK_STRING,
+				SK_FLAG,
+				SK_BED
+			} SpecKindT;
+
+			// Merged intervals of one contig, [starts[i], ends[i]), both ascending
+			struct IntervalsT {
+				std::vector<hts_pos_t> starts;
+				std::vector<hts_pos_t> ends;
+			};
+
+			std::string m_text;
+			SpecKindT m_kind;
+			std::string m_tag;
+			std::vector<double> m_edges;
+			std::vector<std::string> m_matches;
+			std::map<std::string, IntervalsT> m_intervals;	// by contig name
+			std::vector<std::string> m_labels;
+
+			StratificationSpec();
+			bool readBed(const std::string& filename);
+	};
+}
+
+#endif
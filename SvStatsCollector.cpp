@@ -0,0 +1,204 @@
+#include "SvStatsCollector.h"
+#include "VariantAlleles.h"
+
+#include <cstring>
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+SvStatsCollector::SvStatsCollector(bcf_hdr_t* hdr) :
+	AbstractStatCollector(),
+	m_records(0),
+	m_alleles(0),
+	m_noLength(0),
+	m_lengthHist(HdrBinning(kSvLengthPrecision, kMaxSvLength)),
+	m_typeCounts(SV_SIZE, 0),
+	m_typeNoLength(SV_SIZE, 0),
+	m_typeLengthHists(SV_SIZE, Histogram<HdrBinning>(HdrBinning(kSvLengthPrecision, kMaxSvLength))),
+	m_values(NULL),
+	m_valuesSize(0) {
+
+	for(int i = 0; i < hdr->nhrec; i++) {
+		bcf_hrec_t* hrec = hdr->hrec[i];
+		if(hrec->key == NULL || strcmp(hrec->key, "ALT") != 0) continue;
+
+		int idKey = bcf_hrec_find_key(hrec, "ID");
+		if(idKey < 0) continue;
+
+		const char* id = hrec->vals[idKey];
+		m_symbolicTypes[id] = classifySymbolic(id, strlen(id));
+	}
+}
+
+SvStatsCollector::~SvStatsCollector() {
+	free(m_values);
+}
+
+SvTypeT SvStatsCollector::classifySymbolic(const char* id, size_t length) {
+	const char* colon = (const char*) memchr(id, ':', length);
+	size_t topLength = colon != NULL ? colon - id : length;
+
+	if(topLength == 3) {
+		if(memcmp(id, "DEL", 3) == 0) return SV_DEL;
+		if(memcmp(id, "DUP", 3) == 0) return SV_DUP;
+		if(memcmp(id, "INV", 3) == 0) return SV_INV;
+		if(memcmp(id, "INS", 3) == 0) return SV_INS;
+		if(memcmp(id, "CNV", 3) == 0) return SV_CNV;
+		if(memcmp(id, "BND", 3) == 0) return SV_BND;
+	}
+
+	// gVCF reference blocks and other placeholders for unseen alleles
+	if((length == 1 && (id[0] == '*' || id[0] == 'X')) || (length == 7 && memcmp(id, "NON_REF", 7) == 0)) {
+		return SV_SIZE;
+	}
+
+	// copy number alleles CN0, CN1, ...
+	bool copyNumber = topLength > 2 && id[0] == 'C' && id[1] == 'N';
+	for(size_t i = 2; copyNumber && i < topLength; i++) copyNumber = isdigit(id[i]);
+	return copyNumber ? SV_CNV : SV_OTHER;
+}
+
+const char* SvStatsCollector::svTypeLabel(size_t type) {
+	switch(type) {
+		case SV_DEL:
+			return "DEL";
+		case SV_DUP:
+			return "DUP";
+		case SV_INV:
+			return "INV";
+		case SV_INS:
+			return "INS";
+		case SV_CNV:
+			return "CNV";
+		case SV_BND:
+			return "BND";
+		default:
+			return "OTHER";
+	}
+}
+
+SvTypeT SvStatsCollector::symbolicType(const char* allele, int length) {
+	// allele is <ID>
+	m_id.assign(allele + 1, length - 1 - (allele[length - 1] == '>'));
+
+	unordered_map<string, uint8_t>::iterator loc = m_symbolicTypes.find(m_id);
+	if(loc != m_symbolicTypes.end()) return SvTypeT(loc->second);
+
+	// An ID the header does not declare
+	SvTypeT type = classifySymbolic(m_id.data(), m_id.size());
+	m_symbolicTypes[m_id] = type;
+	return type;
+}
+
+int64_t SvStatsCollector::alleleLengths(bcf_hdr_t* hdr, bcf1_t* var, vector<int64_t>& svLengths) {
+	int altCount = var->n_allele - 1;
+	svLengths.assign(altCount, -1);
+
+	int n = bcf_get_info_int32(hdr, var, "SVLEN", &m_values, &m_valuesSize);
+	if(n == altCount || n == 1) {
+		for(int i = 0; i < altCount; i++) {
+			int32_t svlen = m_values[n == 1 ? 0 : i];
+			if(svlen != bcf_int32_missing && svlen != bcf_int32_vector_end) svLengths[i] = llabs(int64_t(svlen));
+		}
+	}
+
+	// END is 1-based and inclusive, POS of a symbolic allele is the padding base
+	if(bcf_get_info_int32(hdr, var, "END", &m_values, &m_valuesSize) == 1 && m_values[0] > var->pos) {
+		return int64_t(m_values[0]) - (var->pos + 1);
+	}
+	return -1;
+}
+
+void SvStatsCollector::processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) {
+	const VariantAlleles& alleles = VariantAlleles::of(var);
+	m_records++;
+
+	bool lengthsRead = false;
+	int64_t span = -1;
+
+	for(int altIndex = 1; altIndex < var->n_allele; altIndex++) {
+		const char* allele = var->d.allele[altIndex];
+		int length = alleles.length(altIndex);
+
+		// Breakends are t[p[, t]p], ]p]t, [p[t, or .t and t. when single;
+		// p may name an assembly contig as <ctg>
+		SvTypeT type;
+		if(allele[0] == '<') {
+			type = symbolicType(allele, length);
+			if(type == SV_SIZE) continue;
+		}
+		else if(memchr(allele, '[', length) != NULL || memchr(allele, ']', length) != NULL ||
+				(length > 1 && (allele[0] == '.' || allele[length - 1] == '.'))) {
+			type = SV_BND;
+		}
+		else {
+			continue;
+		}
+
+		m_alleles++;
+		m_typeCounts[type]++;
+		if(type == SV_BND) continue;
+
+		if(!lengthsRead) {
+			span = alleleLengths(hdr, var, m_svLengths);
+			lengthsRead = true;
+		}
+
+		int64_t svLength = m_svLengths[altIndex - 1];
+		if(svLength < 0 && type != SV_INS) svLength = span;
+		if(svLength < 0) {
+			m_noLength++;
+			m_typeNoLength[type]++;
+			continue;
+		}
+
+		m_lengthHist.add(svLength);
+		m_typeLengthHists[type].add(svLength);
+	}
+}
+
+void SvStatsCollector::mergeImpl(const AbstractStatCollector& otherCollector) {
+	const SvStatsCollector& other = static_cast<const SvStatsCollector&>(otherCollector);
+
+	m_records += other.m_records;
+	m_alleles += other.m_alleles;
+	m_noLength += other.m_noLength;
+	m_lengthHist.merge(other.m_lengthHist);
+
+	for(size_t type = 0; type < SV_SIZE; type++) {
+		m_typeCounts[type] += other.m_typeCounts[type];
+		m_typeNoLength[type] += other.m_typeNoLength[type];
+		m_typeLengthHists[type].merge(other.m_typeLengthHists[type]);
+	}
+}
+
+bool SvStatsCollector::isSatisfiedImpl() {
+	for(size_t type = 0; type < SV_SIZE; type++) {
+		if(!isProportionSettled(m_typeCounts[type], m_alleles, m_records)) return false;
+	}
+
+	return true;
+}
+
+void SvStatsCollector::appendJsonImpl(json_t * jsonRootObj) {
+	json_t * j_sv = json_object();
+	json_object_set_new(j_sv, "alleles", json_integer(m_alleles));
+	json_object_set_new(j_sv, "noLength", json_integer(m_noLength));
+
+	// Bins are labelled by their lower bound
+	json_object_set_new(j_sv, "lengthHist", m_lengthHist.toJson());
+
+	json_t * j_types = json_object();
+	for(size_t type = 0; type < SV_SIZE; type++) {
+		json_t * j_type = json_object();
+		json_object_set_new(j_type, "alleles", json_integer(m_typeCounts[type]));
+		if(type != SV_BND) {
+			json_object_set_new(j_type, "noLength", json_integer(m_typeNoLength[type]));
+			json_object_set_new(j_type, "lengthHist", m_typeLengthHists[type].toJson());
+		}
+		json_object_set_new(j_types, svTypeLabel(type), j_type);
+	}
+	json_object_set_new(j_sv, "types", j_types);
+
+	json_object_set_new(jsonRootObj, "sv", j_sv);
+}
@@ -0,0 +1,103 @@
+#ifndef SVSTATSCOLLECTOR_H
+#define SVSTATSCOLLECTOR_H
+
+#pragma once
+
+#include "AbstractStatCollector.h"
+#include "Histogram.h"
+
+#include <unordered_map>
+
+namespace VcfStatsAlive {
+
+	// SV lengths exact up to 63 bp, then in bins of at most 1/32 of their values
+	static const double kSvLengthPrecision = 1.0 / 32;
+	static const int64_t kMaxSvLength = INT32_MAX;
+
+	typedef enum {
+		SV_DEL = 0,
+		SV_DUP,
+		SV_INV,
+		SV_INS,
+		SV_CNV,
+		SV_BND,
+		SV_OTHER,
+		SV_SIZE
+	} SvTypeT;
+
+	/**
+	 * Collect counts and length distributions of structural variants, by
+	 * type, from symbolic alleles such as <DEL> or <DUP:TANDEM> and from
+	 * breakends such as G]17:198982] or .A
+	 *
+	 * Symbolic allele IDs are classified by their top level type, the part
+	 * before the first ':'; CN0, CN1, ... count as CNV. The IDs declared in
+	 * ##ALT header lines are classified up front into a table, and IDs that
+	 * are not declared are added on first sight, so that a record costs a
+	 * table lookup per symbolic allele. The placeholders <*>, <X> and
+	 * <NON_REF> of gVCFs are not counted.
+	 *
+	 * The length of an allele is the absolute value of its INFO/SVLEN,
+	 * which may have one value per ALT or one for the record, or else
+	 * INFO/END - POS, except for insertions, whose END is their POS.
+	 * Breakends have no length. Lengths range from tens of bp to
+	 * megabases, so they are binned log-linearly in a fixed number of bins.
+	 *
+	 * A sampled run is satisfied once the share of every type among the
+	 * alleles is settled; files without SVs settle by record count.
+	 */
+	class SvStatsCollector : public AbstractStatCollector {
+
+		protected:
+			uint64_t m_records;
+			uint64_t m_alleles;			// symbolic and breakend alleles
+			uint64_t m_noLength;		// such alleles without SVLEN or END, breakends excepted
+			Histogram<HdrBinning> m_lengthHist;
+
+			// by SvTypeT
+			std::vector<uint64_t> m_typeCounts;
+			std::vector<uint64_t> m_typeNoLength;
+			std::vector<Histogram<HdrBinning> > m_typeLengthHists;
+
+			// symbolic allele ID, without the angle brackets, to SvTypeT
+			std::unordered_map<std::string, uint8_t> m_symbolicTypes;
+
+			// reusable buffers
+			int32_t* m_values;
+			int m_valuesSize;
+			std::vector<int64_t> m_svLengths;
+			std::string m_id;
+
+			virtual void processVariantImpl(bcf_hdr_t* hdr, bcf1_t* var) override;
+			virtual void appendJsonImpl(json_t * jsonRootObj) override;
+			virtual void mergeImpl(const AbstractStatCollector& other) override;
+			virtual bool isSatisfiedImpl() override;
+
+		private:
+			SvTypeT symbolicType(const char* allele, int length);
+
+			/**
+			 * @param svLengths Receives the |SVLEN| of every ALT, -1 where unknown
+			 * @return END - POS, or -1 without END
+			 */
+			int64_t alleleLengths(bcf_hdr_t* hdr, bcf1_t* var, std::vector<int64_t>& svLengths);
+
+		public:
+			/**
+			 * @param hdr The vcf header, whose ##ALT lines declare symbolic alleles
+			 */
+			SvStatsCollector(bcf_hdr_t* hdr);
+			virtual ~SvStatsCollector();
+
+			/**
+			 * @param id A symbolic allele ID without angle brackets, e.g. DUP:TANDEM
+			 * @param length The length of the ID
+			 * @return The type, or SV_SIZE for the placeholders *, X and NON_REF
+			 */
+			static SvTypeT classifySymbolic(const char* id, size_t length);
+
+			static const char* svTypeLabel(size_t type);
+	};
+}
+
+#endif
@@ -0,0 +1,55 @@
+#include "VariantAlleles.h"
+
+#include <cstring>
+
+using namespace std;
+using namespace VcfStatsAlive;
+
+VariantAlleles::VariantAlleles() :
+	m_var(NULL),
+	m_isSnp(false) {
+}
+
+VariantAlleles& VariantAlleles::instance() {
+	static thread_local VariantAlleles alleles;
+	return alleles;
+}
+
+const VariantAlleles& VariantAlleles::of(bcf1_t* var) {
+	VariantAlleles& alleles = instance();
+	if(alleles.m_var != var) alleles.describe(var);
+	return alleles;
+}
+
+void VariantAlleles::invalidate() {
+	instance().m_var = NULL;
+}
+
+void VariantAlleles::describe(bcf1_t* var) {
+	// Copies such as the per-sample subsets of BySampleStratifier come
+	// packed; this is a no-op for records that are already unpacked
+	bcf_unpack(var, BCF_UN_STR);
+
+	int n = var->n_allele;
+
+	// The vectors only grow, so steady state processing does not allocate
+	m_lengths.resize(n);
+	m_firstBases.resize(n);
+	m_symbolic.resize(n);
+	m_isSnp = true;
+
+	for(int i = 0; i < n; i++) {
+		const char* allele = var->d.allele[i];
+		int length = strlen(allele);
+
+		m_lengths[i] = length;
+		m_firstBases[i] = allele[0];
+		m_symbolic[i] = memchr(allele, '<', length) != NULL;
+
+		if(length == 1 && allele[0] != '*') continue;
+		if(length == 3 && allele[0] == '<' && (allele[1] == 'X' || allele[1] == '*') && allele[2] == '>') continue;
+		m_isSnp = false;
+	}
+
+	m_var = var;
+}
@@ -0,0 +1,62 @@
+#ifndef VARIANTALLELES_H
+#define VARIANTALLELES_H
+
+#pragma once
+
+namespace VcfStatsAlive {
+
+	/**
+	 * Per-record allele descriptors shared by all collectors of a tree
+	 *
+	 * Allele lengths, the symbolic flag and first bases are computed from
+	 * the unpacked allele strings once per record, on the first call to
+	 * of(), instead of by every collector that looks at them. The
+	 * descriptor is cached per thread; AbstractStatCollector::processVariant()
+	 * invalidates it when a new record enters the root of a tree, so a
+	 * record buffer reused for the next record is never mistaken for the
+	 * previous one. Records handed to sub-trees (e.g. sample subsets of a
+	 * stratifier) are told apart by their address.
+	 */
+	class VariantAlleles {
+		public:
+			/**
+			 * @param var The htslib variant, unpacked to BCF_UN_STR if need be
+			 * @return The descriptors of the record's alleles, valid until
+			 *         the next record is processed on this thread
+			 */
+			static const VariantAlleles& of(bcf1_t* var);
+
+			/**
+			 * Forget the cached record of the calling thread
+			 */
+			static void invalidate();
+
+			int count() const { return int(m_lengths.size()); }
+			int length(int allele) const { return m_lengths[allele]; }
+			char firstBase(int allele) const { return m_firstBases[allele]; }
+
+			/**
+			 * @return true if the allele is symbolic, e.g. <DEL>
+			 */
+			bool isSymbolic(int allele) const { return m_symbolic[allele] != 0; }
+
+			/**
+			 * @return The same as bcf_is_snp(): all alleles are single
+			 *         bases, '*' excepted, or the <X> / <*> placeholders
+			 */
+			bool isSnp() const { return m_isSnp; }
+
+		private:
+			const bcf1_t* m_var;
+			std::vector<int> m_lengths;
+			std::vector<char> m_firstBases;
+			std::vector<char> m_symbolic;
+			bool m_isSnp;
+
+			VariantAlleles();
+			static VariantAlleles& instance();
+			void describe(bcf1_t* var);
+	};
+}
+
+#endif
@@ -0,0 +1,138 @@
+#include "VcfRecordRing.h"
+
+#include <chrono>
+
+using namespace VcfStatsAlive;
+
+namespace {
+	// Spin briefly, then yield, then sleep; a stalled network read can
+	// keep the other side waiting for a long time.
+	inline void backoff(unsigned int& spins) {
+		if(spins < 64) {
+			spins++;
+		}
+		else if(spins < 128) {
+			spins++;
+			std::this_thread::yield();
+		}
+		else {
+			std::this_thread::sleep_for(std::chrono::microseconds(50));
+		}
+	}
+}
+
+VcfRecordRing::VcfRecordRing(htsFile* fp, bcf_hdr_t* hdr, size_t capacity, int unpackFlags) :
+	_fp(fp),
+	_hdr(hdr),
+	_readHdr(bcf_hdr_dup(hdr)),
+	_unpackFlags(unpackFlags),
+	_head(0),
+	_tail(0),
+	_eof(false),
+	_error(false),
+	_stopRequested(false),
+	_headerSynced(true) {
+
+	size_t slots = 2;
+	while(slots < capacity) slots <<= 1;
+
+	_mask = slots - 1;
+	_slots.resize(slots);
+	_headerGrew.assign(slots, 0);
+	for(size_t i = 0; i < slots; i++) {
+		_slots[i] = bcf_init();
+	}
+}
+
+VcfRecordRing::~VcfRecordRing() {
+	stop();
+
+	for(size_t i = 0; i < _slots.size(); i++) {
+		bcf_destroy(_slots[i]);
+	}
+	bcf_hdr_destroy(_readHdr);
+}
+
+void VcfRecordRing::start() {
+	if(_producer.joinable()) return;
+	_producer = std::thread(&VcfRecordRing::produce, this);
+}
+
+void VcfRecordRing::stop() {
+	_stopRequested.store(true, std::memory_order_release);
+	if(_producer.joinable()) _producer.join();
+}
+
+void VcfRecordRing::produce() {
+	size_t head = _head.load(std::memory_order_relaxed);
+	unsigned int spins = 0;
+
+	while(!_stopRequested.load(std::memory_order_acquire)) {
+
+		// Wait for a free slot
+		if(head - _tail.load(std::memory_order_acquire) > _mask) {
+			backoff(spins);
+			continue;
+		}
+		spins = 0;
+
+		bcf1_t* slot = _slots[head & _mask];
+		int ids = _readHdr->n[BCF_DT_ID];
+		int contigs = _readHdr->n[BCF_DT_CTG];
+		int ret = bcf_read(_fp, _readHdr, slot);
+		if(ret != 0) {
+			if(ret < -1) _error.store(true, std::memory_order_release);
+			break;
+		}
+
+		if(_unpackFlags != 0 && bcf_unpack(slot, _unpackFlags) != 0) {
+			std::cerr<<"Error unpacking"<<std::endl;
+		}
+
+		bool grew = _readHdr->n[BCF_DT_ID] != ids || _readHdr->n[BCF_DT_CTG] != contigs;
+		_headerGrew[head & _mask] = grew;
+		if(grew) _headerSynced.store(false, std::memory_order_relaxed);
+
+		_head.store(++head, std::memory_order_release);
+
+		// _readHdr must not change while acquire() merges it
+		while(grew && !_headerSynced.load(std::memory_order_acquire) &&
+				!_stopRequested.load(std::memory_order_acquire)) {
+			backoff(spins);
+		}
+		spins = 0;
+	}
+
+	_eof.store(true, std::memory_order_release);
+}
+
+bcf1_t* VcfRecordRing::acquire() {
+	size_t tail = _tail.load(std::memory_order_relaxed);
+	unsigned int spins = 0;
+
+	while(_head.load(std::memory_order_acquire) == tail) {
+		// The head has to be checked again after seeing eof, as the last
+		// record may have been published in between
+		if(_eof.load(std::memory_order_acquire) &&
+				_head.load(std::memory_order_acquire) == tail)
+			return NULL;
+		backoff(spins);
+	}
+
+	size_t index = tail & _mask;
+	if(_headerGrew[index]) {
+		// The decode thread waits for this, see produce()
+		bcf_hdr_merge(_hdr, _readHdr);
+		if(_hdr->n[BCF_DT_ID] != _readHdr->n[BCF_DT_ID] || _hdr->n[BCF_DT_CTG] != _readHdr->n[BCF_DT_CTG]) {
+			std::cerr<<"Header records added while reading do not match the header"<<std::endl;
+		}
+		_headerGrew[index] = 0;
+		_headerSynced.store(true, std::memory_order_release);
+	}
+
+	return _slots[index];
+}
+
+void VcfRecordRing::release() {
+	_tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
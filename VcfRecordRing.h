@@ -0,0 +1,104 @@
+#ifndef VCFRECORDRING_H
+#define VCFRECORDRING_H
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+namespace VcfStatsAlive {
+
+	static const size_t kDefaultRingCapacity = 1024;
+
+	/**
+	 * A bounded single-producer/single-consumer ring of decoded records
+	 *
+	 * The ring owns a fixed number of preallocated bcf1_t slots. A decode
+	 * thread reads (and unpacks) records from the htslib stream into free
+	 * slots ahead of the consumer, so that I/O and decompression overlap
+	 * with statistics collection. Slots are handed back and forth through
+	 * two atomic counters; no locks are taken and no records are allocated
+	 * once the ring is constructed, since bcf_read reuses the memory of the
+	 * slot it is given.
+	 *
+	 * The consumer calls acquire() to obtain the next record and release()
+	 * once it is done with it. Only one record may be held at a time.
+	 *
+	 * The decode thread parses into a private copy of the header, since
+	 * htslib adds records to the header (and reallocates its dictionaries)
+	 * when it meets an undeclared INFO, FORMAT, FILTER or contig. After
+	 * such a record the decode thread waits until acquire(), on the
+	 * consumer thread, has merged the additions into the header given to
+	 * the constructor, so the consumer may read that header without locks.
+	 * Both headers start out equal and grow in the same order, so the
+	 * additions get the same ids in both.
+	 */
+	class VcfRecordRing {
+		public:
+			/**
+			 * @param fp The opened vcf/bcf stream, positioned after the header
+			 * @param hdr The header of the stream, only read and updated on
+			 *            the consumer thread once the ring is started
+			 * @param capacity Number of slots, rounded up to a power of two
+			 * @param unpackFlags The bcf_unpack flags applied by the decode thread
+			 */
+			VcfRecordRing(htsFile* fp, bcf_hdr_t* hdr,
+					size_t capacity = kDefaultRingCapacity, int unpackFlags = BCF_UN_STR);
+			virtual ~VcfRecordRing();
+
+			/**
+			 * Start the decode thread
+			 */
+			void start();
+
+			/**
+			 * Stop the decode thread early and wait for it to exit
+			 */
+			void stop();
+
+			/**
+			 * Wait for the next decoded record
+			 *
+			 * @return The record, or NULL once the stream is exhausted
+			 */
+			bcf1_t* acquire();
+
+			/**
+			 * Hand the record returned by acquire() back to the decode thread
+			 */
+			void release();
+
+			/**
+			 * @return true if the decode thread stopped on a read error
+			 */
+			bool hasError() const { return _error.load(std::memory_order_acquire); }
+
+		private:
+			void produce();
+
+			htsFile* _fp;
+			bcf_hdr_t* _hdr;
+			bcf_hdr_t* _readHdr;	// the decode thread's copy of _hdr
+			int _unpackFlags;
+
+			std::vector<bcf1_t*> _slots;
+			// set by the producer for records that added to _readHdr
+			std::vector<char> _headerGrew;
+			size_t _mask;
+
+			// written by the producer, read by the consumer
+			alignas(64) std::atomic<size_t> _head;
+			// written by the consumer, read by the producer
+			alignas(64) std::atomic<size_t> _tail;
+
+			std::atomic<bool> _eof;
+			std::atomic<bool> _error;
+			std::atomic<bool> _stopRequested;
+			// cleared by the producer until acquire() merged _readHdr into _hdr
+			std::atomic<bool> _headerSynced;
+
+			std::thread _producer;
+	};
+}
+
+#endif
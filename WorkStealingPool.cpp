@@ -0,0 +1,100 @@
+#include "WorkStealingPool.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace VcfStatsAlive;
+
+WorkStealingPool::WorkStealingPool(size_t workers) :
+	_pending(0),
+	_idle(0),
+	_nextQueue(0) {
+
+	if(workers == 0) workers = std::thread::hardware_concurrency();
+	if(workers == 0) workers = 1;
+
+	for(size_t i = 0; i < workers; i++) {
+		_queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+	}
+}
+
+WorkStealingPool::~WorkStealingPool() {
+}
+
+void WorkStealingPool::submit(TaskT task) {
+	spawn(_nextQueue, task);
+	_nextQueue = (_nextQueue + 1) % _queues.size();
+}
+
+void WorkStealingPool::spawn(size_t worker, TaskT task) {
+	// Count the task before it becomes visible, so that no worker can
+	// observe an empty pool while it is being queued
+	_pending.fetch_add(1, std::memory_order_acq_rel);
+
+	WorkerQueue& queue = *_queues[worker % _queues.size()];
+	std::lock_guard<std::mutex> guard(queue.lock);
+	queue.tasks.push_back(task);
+}
+
+bool WorkStealingPool::popLocal(size_t worker, TaskT& task) {
+	WorkerQueue& queue = *_queues[worker];
+	std::lock_guard<std::mutex> guard(queue.lock);
+	if(queue.tasks.empty()) return false;
+
+	task = queue.tasks.back();
+	queue.tasks.pop_back();
+	return true;
+}
+
+bool WorkStealingPool::steal(size_t worker, TaskT& task) {
+	for(size_t i = 1; i < _queues.size(); i++) {
+		WorkerQueue& queue = *_queues[(worker + i) % _queues.size()];
+		std::lock_guard<std::mutex> guard(queue.lock);
+		if(queue.tasks.empty()) continue;
+
+		// Steal the oldest task, which tends to be the largest
+		task = queue.tasks.front();
+		queue.tasks.pop_front();
+		return true;
+	}
+	return false;
+}
+
+void WorkStealingPool::work(size_t worker) {
+	TaskT task;
+	bool idle = false;
+
+	while(_pending.load(std::memory_order_acquire) > 0) {
+		if(popLocal(worker, task) || steal(worker, task)) {
+			if(idle) {
+				_idle.fetch_sub(1, std::memory_order_relaxed);
+				idle = false;
+			}
+
+			task(worker);
+			task = TaskT();
+			_pending.fetch_sub(1, std::memory_order_acq_rel);
+		}
+		else {
+			if(!idle) {
+				_idle.fetch_add(1, std::memory_order_relaxed);
+				idle = true;
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+
+	if(idle) _idle.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void WorkStealingPool::run() {
+	std::vector<std::thread> threads;
+	for(size_t worker = 1; worker < _queues.size(); worker++) {
+		threads.push_back(std::thread(&WorkStealingPool::work, this, worker));
+	}
+
+	// The calling thread acts as worker 0
+	work(0);
+
+	for(size_t i = 0; i < threads.size(); i++) threads[i].join();
+}
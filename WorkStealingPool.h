@@ -0,0 +1,75 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace VcfStatsAlive {
+
+	/**
+	 * A fixed-size thread pool with per-worker task queues
+	 *
+	 * Each worker pops tasks from the back of its own queue; a worker whose
+	 * queue is empty steals from the front of another worker's queue. Tasks
+	 * receive the index of the worker running them, which lets callers
+	 * keep per-worker state (e.g. one collector tree per worker) without
+	 * locking, and lets a task spawn follow-up tasks onto its own queue
+	 * where idle workers can steal them.
+	 */
+	class WorkStealingPool {
+		public:
+			using TaskT = std::function<void(size_t worker)>;
+
+			/**
+			 * @param workers The number of worker threads; 0 uses one per core
+			 */
+			WorkStealingPool(size_t workers = 0);
+			virtual ~WorkStealingPool();
+
+			/**
+			 * Queue a task, spreading submissions across the workers
+			 */
+			void submit(TaskT task);
+
+			/**
+			 * Queue a task on a specific worker, typically the one currently
+			 * running, from within a task
+			 */
+			void spawn(size_t worker, TaskT task);
+
+			/**
+			 * Run all queued tasks, including the ones they spawn, and return
+			 * once every task has finished
+			 */
+			void run();
+
+			/**
+			 * @return true if at least one worker is looking for work
+			 */
+			bool hasIdleWorkers() const { return _idle.load(std::memory_order_relaxed) > 0; }
+
+			size_t workers() const { return _queues.size(); }
+
+		private:
+			struct WorkerQueue {
+				std::mutex lock;
+				std::deque<TaskT> tasks;
+			};
+
+			std::vector<std::unique_ptr<WorkerQueue>> _queues;
+			std::atomic<size_t> _pending;
+			std::atomic<size_t> _idle;
+			size_t _nextQueue;
+
+			bool popLocal(size_t worker, TaskT& task);
+			bool steal(size_t worker, TaskT& task);
+			void work(size_t worker);
+	};
+}
+
+#endif
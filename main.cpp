@@ -7,6 +7,22 @@
 #include <memory>
 
 #include "BasicStatsCollector.h"
+#include "QuantileStatsCollector.h"
+#include "CardinalityStatsCollector.h"
+#include "DensityTrackCollector.h"
+#include "ReservoirSampleCollector.h"
+#include "MutationContextCollector.h"
+#include "IndelNormalizationCollector.h"
+#include "AlleleFrequencyCollector.h"
+#include "AlleleSpectrumCollector.h"
+#include "HardyWeinbergCollector.h"
+#include "SvStatsCollector.h"
+#include "ConcordanceComparator.h"
+#include "ByRegionStratifier.h"
+#include "ByFilterStratifier.h"
+#include "ByExpressionStratifier.h"
+#include "VcfRecordRing.h"
+#include "ShardScheduler.h"
 
 using namespace std;
 using namespace VcfStatsAlive;
@@ -20,6 +36,26 @@ static struct option getopt_options[] =
 	{"qual-upper-val",	optional_argument,	0, 'Q'},
 	{"log-scale-af",	optional_argument,	0, 'l'},
 	{"batch",			optional_argument,	0, 'b'},
+	{"quantiles",		no_argument,		0, 'p'},
+	{"distinct",		no_argument,		0, 'd'},
+	{"by-region",		required_argument,	0, 'r'},
+	{"density",			required_argument,	0, 'D'},
+	{"threads",			required_argument,	0, 't'},
+	{"file-list",		required_argument,	0, 'L'},
+	{"per-file",		no_argument,		0, 's'},
+	{"sample",			required_argument,	0, 'S'},
+	{"confidence",		required_argument,	0, 'C'},
+	{"examples",		required_argument,	0, 'x'},
+	{"reference",		required_argument,	0, 'R'},
+	{"check-norm",		no_argument,		0, 'n'},
+	{"concordance",		required_argument,	0, 'c'},
+	{"sfs",				no_argument,		0, 'F'},
+	{"count-gt",		no_argument,		0, 'G'},
+	{"hwe",				no_argument,		0, 'H'},
+	{"alt-af",			required_argument,	0, 'A'},
+	{"sv",				no_argument,		0, 'V'},
+	{"by-filter",		no_argument,		0, 'B'},
+	{"stratify",		required_argument,	0, 'e'},
 	{0, 0, 0, 0}
 };
 
@@ -27,23 +63,71 @@ static unsigned int updateRate;
 static unsigned int firstUpdateRate;
 static int qualHistLowerVal;
 static int qualHistUpperVal;
-
-void printStatsJansson(AbstractStatCollector* rootStatCollector);
+static bool logScaleAF;
+static bool quantiles;
+static bool distinct;
+static long regionWindow;
+static long densityBinSize;
+static int threads;
+static double sampleHalfWidth;
+static double sampleConfidence;
+static long examplesPerCategory;
+static shared_ptr<ReferenceFasta> reference;
+static bool checkNormalization;
+static string concordanceFile;
+static bool alleleSpectrum;
+static bool trustInfoCounts;
+static bool hardyWeinberg;
+static vector<double> altAlleleFreqEdges;
+static bool svStats;
+static bool byFilter;
+static vector<shared_ptr<const StratificationSpec> > stratifications;
+
+AbstractStatCollector* createStatsTree(bcf_hdr_t* hdr);
+AbstractStatCollector* createRootCollector(bcf_hdr_t* hdr);
+int processFiles(const vector<string>& filenames, bool perFile);
+int compareFiles(const string& first, const string& second);
+void printStatsJansson(AbstractStatCollector* rootStatCollector, json_t* j_files = NULL);
+void printJson(json_t* j_root);
 
 int main(int argc, char* argv[]) {
 
 	string filename;
+	vector<string> filenames;
+	bool perFile = false;
 	updateRate = 1000;
 	firstUpdateRate = 0;
 	qualHistLowerVal = 1;
 	qualHistUpperVal = 200;
-	bool logScaleAF = false;
+	logScaleAF = false;
 	bool batch = false;
+	quantiles = false;
+	distinct = false;
+	regionWindow = -1;
+	densityBinSize = 0;
+	threads = -1;
+	sampleHalfWidth = 0;
+	sampleConfidence = 0.95;
+	examplesPerCategory = 0;
+	checkNormalization = false;
+	alleleSpectrum = false;
+	trustInfoCounts = true;
+	hardyWeinberg = false;
+	svStats = false;
+	byFilter = false;
 
 	int option_index = 0;
 
+	// Options of the stats run, which a concordance run would ignore
+	string statsOptions;
+
 	int ch;
-	while((ch = getopt_long (argc, argv, "f:u:q:Q:l", getopt_options, &option_index)) != -1) {
+	while((ch = getopt_long (argc, argv, "f:u:q:Q:lpdr:D:t:L:sS:C:x:R:nc:FGHA:VBe:", getopt_options, &option_index)) != -1) {
+		if(ch != 'c' && ch != 'L' && ch != '?') {
+			statsOptions += statsOptions.empty() ? "-" : " -";
+			statsOptions += char(ch);
+		}
+
 		switch(ch) {
 			case 0:
 				break;
@@ -73,6 +157,104 @@ int main(int argc, char* argv[]) {
 			case 'b':
 				batch = true;
 				break;
+			case 'p':
+				quantiles = true;
+				break;
+			case 'd':
+				distinct = true;
+				break;
+			case 'r':
+				regionWindow = strtol(optarg, NULL, 10);
+				if(regionWindow < 0) {
+					cerr<<"Invalid region window size "<<regionWindow<<endl;
+					exit(1);
+				}
+				break;
+			case 'D':
+				densityBinSize = strtol(optarg, NULL, 10);
+				if(densityBinSize <= 0) {
+					cerr<<"Invalid density bin size "<<densityBinSize<<endl;
+					exit(1);
+				}
+				break;
+			case 't':
+				threads = strtol(optarg, NULL, 10);
+				break;
+			case 'L':
+				{
+					ifstream fileList(optarg);
+					if(!fileList) {
+						cerr<<"Unable to open file list "<<optarg<<endl;
+						exit(1);
+					}
+					string listed;
+					while(getline(fileList, listed)) {
+						if(listed.empty() || listed[0] == '#') continue;
+						filenames.push_back(listed);
+					}
+				}
+				break;
+			case 's':
+				perFile = true;
+				break;
+			case 'S':
+				sampleHalfWidth = strtod(optarg, NULL);
+				if(sampleHalfWidth <= 0 || sampleHalfWidth >= 0.5) {
+					cerr<<"Invalid sampling half-width "<<optarg<<endl;
+					exit(1);
+				}
+				break;
+			case 'C':
+				sampleConfidence = strtod(optarg, NULL);
+				if(sampleConfidence <= 0 || sampleConfidence >= 1) {
+					cerr<<"Invalid sampling confidence level "<<optarg<<endl;
+					exit(1);
+				}
+				break;
+			case 'x':
+				examplesPerCategory = strtol(optarg, NULL, 10);
+				if(examplesPerCategory <= 0) {
+					cerr<<"Invalid number of examples "<<examplesPerCategory<<endl;
+					exit(1);
+				}
+				break;
+			case 'R':
+				reference = ReferenceFasta::open(optarg);
+				if(!reference) exit(1);
+				break;
+			case 'n':
+				checkNormalization = true;
+				break;
+			case 'c':
+				concordanceFile = optarg;
+				break;
+			case 'F':
+				alleleSpectrum = true;
+				break;
+			case 'G':
+				trustInfoCounts = false;
+				break;
+			case 'H':
+				hardyWeinberg = true;
+				break;
+			case 'A':
+				if(!AlleleFrequencyCollector::parseBins(optarg, altAlleleFreqEdges)) {
+					cerr<<"Invalid allele frequency bins "<<optarg<<endl;
+					exit(1);
+				}
+				break;
+			case 'V':
+				svStats = true;
+				break;
+			case 'B':
+				byFilter = true;
+				break;
+			case 'e': {
+				shared_ptr<const StratificationSpec> spec = StratificationSpec::parse(optarg);
+				if(!spec) exit(1);
+				stratifications.push_back(spec);
+				break;
+			}
 			default:
 				break;
 		}
@@ -83,16 +265,49 @@ int main(int argc, char* argv[]) {
 		exit(1);
 	}
 
+	if(checkNormalization && !reference) {
+		cerr<<"Checking indel normalization requires a reference fasta"<<endl;
+		exit(1);
+	}
+
+	// These need every record and would keep a sampled run from stopping
+	if(sampleHalfWidth > 0 && (distinct || densityBinSize > 0 || checkNormalization || alleleSpectrum ||
+			hardyWeinberg)) {
+		cerr<<"Distinct counts, density tracks, normalization checks, allele spectra and HWE tests cannot be estimated from a sample"<<endl;
+		exit(1);
+	}
+
 	argc -= optind;
 	argv += optind;
 
+	for(int i = 0; i < argc; i++) filenames.push_back(argv[i]);
+
+	if(!concordanceFile.empty()) {
+		if(!statsOptions.empty()) {
+			cerr<<"Genotype concordance (-c) takes no other options, got "<<statsOptions<<endl;
+			exit(1);
+		}
+		if(filenames.size() != 1) {
+			cerr<<"Genotype concordance compares exactly one input file against "<<concordanceFile<<endl;
+			exit(1);
+		}
+		return compareFiles(filenames[0], concordanceFile);
+	}
+
+	// Several inputs, one input split across threads when a thread count
+	// is given, or sampled inputs go through the shard scheduler
+	if(filenames.size() > 1 || perFile || (filenames.size() == 1 && threads >= 0 && threads != 1) ||
+			(!filenames.empty() && sampleHalfWidth > 0)) {
+		return processFiles(filenames, perFile);
+	}
+
 	htsFile *fp;
 
-	if (argc == 0) {
+	if (filenames.empty()) {
 		fp = hts_open("-", "r");
 	}
 	else {
-		filename = *argv;
+		filename = filenames[0];
 		fp = hts_open(filename.c_str(), "r");
 	}
 
@@ -101,42 +316,170 @@ int main(int argc, char* argv[]) {
 		exit(1);
 	}
 
-	BasicStatsCollector *bsc = new BasicStatsCollector(qualHistLowerVal, qualHistUpperVal, logScaleAF);
-
 	unsigned long totalVariants = 0;
 
 	bcf_hdr_t* hdr = bcf_hdr_read(fp);
-	bcf1_t* line = bcf_init();
 
-	while(bcf_read(fp, hdr, line) == 0) {
+	AbstractStatCollector *root = createRootCollector(hdr);
 
-		// Unpack alternates and info block
-		if (bcf_unpack(line, BCF_UN_STR) != 0) {
-			std::cerr<<"Error unpacking"<<std::endl;
-		}
+	// Decode records on a separate thread, running ahead of the collectors
+	VcfRecordRing ring(fp, hdr);
+	ring.start();
 
-		bsc->processVariant(hdr, line);
+	bcf1_t* line;
+	while((line = ring.acquire()) != NULL) {
+
+		root->processVariant(hdr, line);
+		ring.release();
 		
 		totalVariants++;
 
+		// A stream can only be sampled from its start
+		if(sampleHalfWidth > 0 && totalVariants % kSatisfiedCheckInterval == 0 && root->isSatisfied()) break;
+
 		if( !batch && ((totalVariants > 0 && totalVariants % updateRate == 0) ||
 				(firstUpdateRate > 0 && totalVariants >= firstUpdateRate))) {
 
-			printStatsJansson(bsc);
+			printStatsJansson(root);
 
 			// disable first update after it has been fired.
 			if(firstUpdateRate > 0) firstUpdateRate = 0;
 		}
 	}
 
-	printStatsJansson(bsc);
+	if(ring.hasError()) {
+		std::cerr<<"Error reading vcf record after "<<totalVariants<<" records"<<std::endl;
+	}
+
+	printStatsJansson(root);
 
-	delete bsc;
+	ring.stop();
+	delete root;
+
+	bcf_hdr_destroy(hdr);
+	hts_close(fp);
 
 	return 0;
 }
 
-void printStatsJansson(AbstractStatCollector* rootStatCollector) {
+AbstractStatCollector* createStatsTree(bcf_hdr_t* hdr) {
+
+	BasicStatsCollector *bsc = new BasicStatsCollector(qualHistLowerVal, qualHistUpperVal, logScaleAF);
+
+	if(quantiles) {
+		bsc->addChild(std::make_shared<QuantileStatsCollector>());
+	}
+
+	if(!altAlleleFreqEdges.empty()) {
+		bsc->addChild(std::make_shared<AlleleFrequencyCollector>(altAlleleFreqEdges));
+	}
+
+	if(distinct) {
+		bsc->addChild(std::make_shared<CardinalityStatsCollector>());
+	}
+
+	if(densityBinSize > 0) {
+		bsc->addChild(std::make_shared<DensityTrackCollector>(hdr, densityBinSize));
+	}
+
+	if(reference) {
+		bsc->addChild(std::make_shared<MutationContextCollector>(reference));
+	}
+
+	if(checkNormalization) {
+		bsc->addChild(std::make_shared<IndelNormalizationCollector>(hdr, reference));
+	}
+
+	if(alleleSpectrum) {
+		bsc->addChild(std::make_shared<AlleleSpectrumCollector>(hdr, trustInfoCounts));
+	}
+
+	if(hardyWeinberg) {
+		bsc->addChild(std::make_shared<HardyWeinbergCollector>());
+	}
+
+	if(svStats) {
+		bsc->addChild(std::make_shared<SvStatsCollector>(hdr));
+	}
+
+	if(examplesPerCategory > 0) {
+		bsc->addChild(std::make_shared<ReservoirSampleCollector>(qualHistLowerVal, qualHistUpperVal, examplesPerCategory));
+	}
+
+	return bsc;
+}
+
+AbstractStatCollector* createFilterTree(bcf_hdr_t* hdr) {
+	if(byFilter)
+		return new ByFilterStratifier<AbstractStatCollector>(hdr,
+				[hdr]() { return createStatsTree(hdr); });
+
+	return createStatsTree(hdr);
+}
+
+AbstractStatCollector* createExpressionTree(bcf_hdr_t* hdr, size_t level) {
+	if(level < stratifications.size())
+		return new ByExpressionStratifier<AbstractStatCollector>(hdr, stratifications[level],
+				[hdr, level]() { return createExpressionTree(hdr, level + 1); });
+
+	return createFilterTree(hdr);
+}
+
+AbstractStatCollector* createRootCollector(bcf_hdr_t* hdr) {
+	AbstractStatCollector* root;
+	if(regionWindow >= 0)
+		root = new ByRegionStratifier<AbstractStatCollector>(hdr, regionWindow,
+				[hdr]() { return createExpressionTree(hdr, 0); });
+	else
+		root = createExpressionTree(hdr, 0);
+
+	if(sampleHalfWidth > 0)
+		root->setSamplingTarget(sampleHalfWidth, AbstractStatCollector::zScore(sampleConfidence));
+
+	return root;
+}
+
+int processFiles(const vector<string>& filenames, bool perFile) {
+
+	if(filenames.empty()) {
+		cerr<<"No input files given"<<endl;
+		return 1;
+	}
+
+	ShardScheduler scheduler(filenames, createRootCollector, threads > 0 ? threads : 0);
+	if(!scheduler.open()) return 1;
+
+	bool succeeded = sampleHalfWidth > 0 ? scheduler.runSampled() : scheduler.run();
+
+	// The combined tree is built from the first file's header; collectors
+	// that depend on the header match the contigs and samples of other
+	// files by name, adding those the first file lacks
+	AbstractStatCollector* combined = createRootCollector(scheduler.header(0));
+
+	// Each file's tree is merged, and reported when asked to, then freed,
+	// so only the combined tree lives on
+	json_t * j_files = perFile ? json_object() : NULL;
+	for(size_t i = 0; i < filenames.size(); i++) {
+		AbstractStatCollector* fileTree = scheduler.takeFileTree(i);
+		if(fileTree == NULL) continue;
+
+		combined->merge(*fileTree);
+		if(perFile) {
+			json_t * j_file = json_object();
+			fileTree->appendJson(j_file);
+			json_object_set_new(j_files, filenames[i].c_str(), j_file);
+		}
+		delete fileTree;
+	}
+
+	printStatsJansson(combined, j_files);
+
+	delete combined;
+
+	return succeeded ? 0 : 1;
+}
+
+void printStatsJansson(AbstractStatCollector* rootStatCollector, json_t* j_files) {
 
 	// Create the root object that contains everything
 	json_t * j_root = json_object();
@@ -144,8 +487,34 @@ void printStatsJansson(AbstractStatCollector* rootStatCollector) {
 	// Let the root object of the collector tree create Json
 	rootStatCollector->appendJson(j_root);
 
+	// Per-file sections of a multi-file run
+	if(j_files != NULL) {
+		json_object_set_new(j_root, "files", j_files);
+	}
+
+	printJson(j_root);
+}
+
+int compareFiles(const string& first, const string& second) {
+
+	ConcordanceComparator comparator(first, second);
+	if(!comparator.open()) return 1;
+
+	bool succeeded = comparator.run();
+
+	json_t * j_root = json_object();
+	comparator.appendJson(j_root);
+	printJson(j_root);
+
+	return succeeded ? 0 : 1;
+}
+
+void printJson(json_t* j_root) {
+
 	// Dump the json
-	cout<<json_dumps(j_root, JSON_COMPACT | JSON_ENSURE_ASCII | JSON_PRESERVE_ORDER)<<";"<<endl;
+	char* dumped = json_dumps(j_root, JSON_COMPACT | JSON_ENSURE_ASCII | JSON_PRESERVE_ORDER);
+	cout<<dumped<<";"<<endl;
+	free(dumped);
 
 	json_decref(j_root);
 }
@@ -57,6 +57,37 @@ class IntegrationTests(unittest.TestCase):
     def test_indel_size(self):
         IntegrationTests._run_test_on( self._regress_indel_size, key='indel_size')
 
+    def test_vcfstats_multi_sample(self):
+        # Per-sample collectors get packed bcf_subset copies of each record
+        proc = subprocess.run(['../vcfstats', 'data/multi-sample.vcf'], stdout=subprocess.PIPE)
+        self.assertEqual(0, proc.returncode)
+
+        observed_json = json.loads(proc.stdout.decode().strip().splitlines()[-1])
+
+        for sample in ['S1', 'S2', 'S3']:
+            self.assertTrue(sample in observed_json, "Observed json missing sample '{0}'".format(sample))
+            self.assertTrue(sample in observed_json['sample_format'])
+            self.assertTrue(sample in observed_json['cohort_qc']['samples'])
+
+        self.assertEqual(4, observed_json['cohort_qc']['records'])
+
+    def test_sharded_matches_serial(self):
+        # Shards are processed on several workers and merged, which must
+        # add up to a serial run: region shards of the tabix-indexed file,
+        # then checkpoint shards of an unindexed copy, whose .vsaidx
+        # sidecar is built on the first run and loaded on the second
+        options = ['-d', '-D', '10000']
+        serial_json = IntegrationTests._run_stats(options + ['-t', '1', 'data/sharded.vcf.gz'])
+        self.assertEqual(833, serial_json['TotalRecords'])
+        self.assertEqual(serial_json, IntegrationTests._run_stats(options + ['-t', '4', 'data/sharded.vcf.gz']))
+
+        shutil.copy('data/sharded.vcf.gz', 'output/unindexed.vcf.gz')
+        sidecar = 'output/unindexed.vcf.gz.vsaidx'
+        self.assertFalse(os.path.exists(sidecar))
+        self.assertEqual(serial_json, IntegrationTests._run_stats(options + ['-t', '4', 'output/unindexed.vcf.gz']))
+        self.assertTrue(os.path.exists(sidecar))
+        self.assertEqual(serial_json, IntegrationTests._run_stats(options + ['-t', '4', 'output/unindexed.vcf.gz']))
+
     #-----------------------------------------------------------------------------
     # Internal test implementation
     #-----------------------------------------------------------------------------
@@ -213,6 +244,16 @@ class IntegrationTests(unittest.TestCase):
             fh.write(last_line)
         fh.close()
 
+    @staticmethod
+    def _run_stats(args):
+        proc = subprocess.run(['../vcfstatsalive'] + args, stdout=subprocess.PIPE)
+        if proc.returncode != 0:
+            raise ValueError("vcfstatsalive {0} failed".format(' '.join(args)))
+
+        # The last line is the final report, the ones before are updates
+        last_line = proc.stdout.decode().strip().splitlines()[-1]
+        return json.loads(re.sub(';$', '', last_line))
+
     def _validate_keys(self, keys, expected_json, observed_json):
         self.assertEqual(len(expected_json), len(observed_json))
         self.assertEqual(len(keys), len(observed_json))
@@ -2,8 +2,12 @@
 #include "SampleBasicStatsCollector.h"
 #include "ByGenotypeStratifier.h"
 #include "BySampleStratifier.h"
+#include "SampleFormatStatsCollector.h"
+#include "CohortQcCollector.h"
+#include "VcfRecordRing.h"
 
 #include <csignal>
+#include <getopt.h>
 
 using namespace VcfStatsAlive;
 
@@ -33,8 +37,28 @@ void printStatsJansson(AbstractStatCollector* rootStatCollector) {
 	json_decref(j_root);
 }
 
-int main(int argc, const char** argv) {
-    argc--; argv++;
+static struct option getopt_options[] =
+{
+    {"qc",  no_argument,    0, 'q'},
+    {0, 0, 0, 0}
+};
+
+int main(int argc, char** argv) {
+    // Only the per-sample QC counters, without the per-sample collector trees
+    bool qcOnly = false;
+
+    int ch;
+    while((ch = getopt_long(argc, argv, "q", getopt_options, NULL)) != -1) {
+        switch(ch) {
+            case 'q':
+                qcOnly = true;
+                break;
+            default:
+                break;
+        }
+    }
+
+    argc -= optind; argv += optind;
 
     htsFile *fp;
 
@@ -50,20 +74,35 @@ int main(int argc, const char** argv) {
 
     bcf_hdr_t* hdr = bcf_hdr_read(fp);
 
-    BySampleStratifier<ByGenotypeStratifier<StatsCollector>> strat(hdr);
+    std::unique_ptr<AbstractStatCollector> root;
+    if(qcOnly) {
+        root.reset(new CohortQcCollector(hdr));
+    }
+    else {
+        root.reset(new BySampleStratifier<ByGenotypeStratifier<StatsCollector>>(hdr));
+
+        // FORMAT fields are read from the full record, for all samples at once
+        root->addChild(std::make_shared<SampleFormatStatsCollector>(hdr));
+        root->addChild(std::make_shared<CohortQcCollector>(hdr));
+    }
 
-	bcf1_t* line = bcf_init();
+    VcfRecordRing ring(fp, hdr);
+    ring.start();
 
     signal(SIGUSR1, progressSignalHandler);
     
-	while(bcf_read(fp, hdr, line) == 0) {
-        strat.processVariant(hdr, line);
+    bcf1_t* line;
+	while((line = ring.acquire()) != NULL) {
+        root->processVariant(hdr, line);
+        ring.release();
         line_count++;
     }
 
-    printStatsJansson(&strat);
+    if (ring.hasError()) std::cerr<<"Error reading vcf record after "<<line_count<<" lines"<<std::endl;
+
+    printStatsJansson(root.get());
 
-    bcf_destroy1(line);
+    ring.stop();
     bcf_hdr_destroy(hdr);
 
     hts_close(fp);